@@ -34,7 +34,7 @@ class Context
 {
 public:
     Context (FullscreenQuad *fsquad, TextureManager *texturemanager,
-             FramebufferManager *framebuffermanager) : programmanager_ (programmanager), fsquad_ (fsquad),
+             FramebufferManager *framebuffermanager) : fsquad_ (fsquad),
             texturemanager_ (texturemanager), framebuffermanager_ (framebuffermanager) {
     }
 
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "ContextRegistry.h"
+#include "detail/FullscreenQuadImpl.h"
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace glutil {
+
+namespace {
+
+thread_local ContextRegistry *current = nullptr;
+std::mutex registrymutex;
+std::unordered_map<const void*, std::unique_ptr<ContextRegistry>> registries;
+
+} /* anonymous namespace */
+
+ContextRegistry::ContextRegistry (void) : fsquads { nullptr, nullptr }
+{
+}
+
+ContextRegistry::~ContextRegistry (void)
+{
+	/* quads that are still referenced outlive the registry */
+	for (auto &fsquad : fsquads)
+	{
+		if (fsquad)
+			fsquad->registry = nullptr;
+	}
+	if (current == this)
+		current = nullptr;
+}
+
+ContextRegistry &ContextRegistry::GetCurrent (void)
+{
+	if (!current)
+	{
+		static thread_local ContextRegistry registry;
+		current = &registry;
+	}
+	return *current;
+}
+
+void ContextRegistry::MakeCurrent (const void *context)
+{
+	if (!context)
+	{
+		current = nullptr;
+		return;
+	}
+	const std::lock_guard<std::mutex> lock (registrymutex);
+	std::unique_ptr<ContextRegistry> &registry = registries[context];
+	if (!registry)
+		registry.reset (new ContextRegistry);
+	current = registry.get ();
+}
+
+void ContextRegistry::Release (const void *context)
+{
+	std::unique_ptr<ContextRegistry> registry;
+	{
+		const std::lock_guard<std::mutex> lock (registrymutex);
+		auto it = registries.find (context);
+		if (it == registries.end ())
+			return;
+		registry = std::move (it->second);
+		registries.erase (it);
+	}
+}
+
+detail::FullscreenQuadImpl *ContextRegistry::AcquireFullscreenQuad (FullscreenQuad::Mode mode)
+{
+	if (!fsquads[mode])
+		fsquads[mode] = new detail::FullscreenQuadImpl (mode, this);
+	fsquads[mode]->AddReference ();
+	return fsquads[mode];
+}
+
+} /* namespace glutil */
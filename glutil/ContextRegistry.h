@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef GLUTIL_CONTEXTREGISTRY_H
+#define GLUTIL_CONTEXTREGISTRY_H
+
+#include <oglp/oglp.h>
+#include "FullscreenQuad.h"
+#include "StateCache.h"
+
+namespace glutil {
+
+/*
+ * Holds the objects glutil shares per GL context. Registries are tied to contexts
+ * by their native handle, e.g. the result of eglGetCurrentContext; the application
+ * calls MakeCurrent with the handle whenever it makes a context current and Release
+ * once the context is destroyed. Threads that never call MakeCurrent use a default
+ * registry of their own. Looking up the current registry is a thread local pointer
+ * load.
+ *
+ * Registries own no GL objects: shared objects like the fullscreen quad are
+ * reference counted by the handles that use them and destroyed with the last one.
+ * The counts are not atomic, so handles of a context must not be copied or
+ * destroyed concurrently from several threads.
+ */
+class ContextRegistry
+{
+public:
+	ContextRegistry (const ContextRegistry&) = delete;
+	~ContextRegistry (void);
+
+	ContextRegistry &operator= (const ContextRegistry&) = delete;
+
+	/* the registry that is current on the calling thread */
+	static ContextRegistry &GetCurrent (void);
+	/* makes the registry of a context current; nullptr selects the default registry of the thread */
+	static void MakeCurrent (const void *context);
+	/* destroys the registry of a context, which must no longer be current on any thread */
+	static void Release (const void *context);
+
+	StateCache &GetStateCache (void) {
+		return state;
+	}
+	/* returns a new reference to the fullscreen quad of the given mode */
+	detail::FullscreenQuadImpl *AcquireFullscreenQuad (FullscreenQuad::Mode mode);
+private:
+	ContextRegistry (void);
+	StateCache state;
+	/* not owned; cleared by the quads when their last reference is released */
+	detail::FullscreenQuadImpl *fsquads[2];
+	friend class detail::FullscreenQuadImpl;
+};
+
+} /* namespace glutil */
+
+#endif /* !defined GLUTIL_CONTEXTREGISTRY_H */
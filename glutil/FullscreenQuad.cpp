@@ -23,30 +23,44 @@
 
 
 #include "FullscreenQuad.h"
+#include "ContextRegistry.h"
 #include "detail/FullscreenQuadImpl.h"
 
 namespace glutil {
 
-FullscreenQuad::FullscreenQuad (void) : impl (detail::FullscreenQuadImpl::GetInstance ()) {
+FullscreenQuad::FullscreenQuad (Mode mode) : impl (ContextRegistry::GetCurrent ().AcquireFullscreenQuad (mode)) {
 }
 
 FullscreenQuad::FullscreenQuad (const FullscreenQuad &fsquad) : impl (fsquad.impl) {
+    if (impl)
+        impl->AddReference ();
 }
 
-FullscreenQuad::FullscreenQuad (FullscreenQuad &&fsquad) : impl (std::move (fsquad.impl)) {
-
+FullscreenQuad::FullscreenQuad (FullscreenQuad &&fsquad) : impl (fsquad.impl) {
+    fsquad.impl = nullptr;
 }
 
 FullscreenQuad::~FullscreenQuad (void) {
+    if (impl)
+        detail::FullscreenQuadImpl::Release (impl);
 }
 
 FullscreenQuad &FullscreenQuad::operator=(const FullscreenQuad &fsquad) {
+    if (fsquad.impl)
+        fsquad.impl->AddReference ();
+    if (impl)
+        detail::FullscreenQuadImpl::Release (impl);
     impl = fsquad.impl;
     return *this;
 }
 
 FullscreenQuad &FullscreenQuad::operator= (FullscreenQuad &&fsquad) noexcept {
-    impl = std::move (fsquad.impl);
+    if (this != &fsquad) {
+        if (impl)
+            detail::FullscreenQuadImpl::Release (impl);
+        impl = fsquad.impl;
+        fsquad.impl = nullptr;
+    }
     return *this;
 }
 
@@ -55,6 +69,11 @@ void FullscreenQuad::Render (void) const {
     impl->Render ();
 }
 
+void FullscreenQuad::Render (StateCache &state) const {
+    assert (impl);
+    impl->Render (state);
+}
+
 const gl::Program &FullscreenQuad::GetVertexProgram (void) const {
     assert (impl);
     return impl->GetVertexProgram ();
@@ -25,27 +25,43 @@
 #define GLUTIL_FULLSCREENQUAD_H
 
 #include <oglp/oglp.h>
-#include <memory>
 
 namespace glutil {
 
+class StateCache;
+
 namespace detail {
 class FullscreenQuadImpl;
 } /* namespace detail */
 
 class FullscreenQuad {
 public:
-    FullscreenQuad (void);
+    /*
+     * TRIANGLE draws a single oversized triangle generated from gl_VertexID without
+     * a vertex buffer, which avoids shading the diagonal of a two triangle strip twice.
+     */
+    enum Mode {
+        TRIANGLE,
+        STRIP
+    };
+    FullscreenQuad (Mode mode = TRIANGLE);
     FullscreenQuad (const FullscreenQuad &fsquad);
     FullscreenQuad (FullscreenQuad &&fsquad);
     ~FullscreenQuad (void);
     FullscreenQuad &operator= (const FullscreenQuad &fsquad);
     FullscreenQuad &operator= (FullscreenQuad &&fsquad) noexcept;
 
+    /* disables depth testing while drawing and restores it afterwards; queries GL instead of a StateCache */
     void Render (void) const;
+    /*
+     * disables depth testing and binds the vertex array through the cache, which has
+     * to reflect the GL state, and restores the cached depth test state afterwards
+     */
+    void Render (StateCache &state) const;
     const gl::Program &GetVertexProgram (void) const;
 private:
-    std::shared_ptr<detail::FullscreenQuadImpl> impl;
+    /* shared by all quads of a mode in the same ContextRegistry and reference counted */
+    detail::FullscreenQuadImpl *impl;
 };
 
 } /* namespace glutil */
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "GPUTimer.h"
+#include <stdexcept>
+
+namespace glutil {
+
+GPUTimer::GPUTimer (size_t _limit) : active (0), limit (_limit)
+{
+}
+
+GPUTimer::~GPUTimer (void)
+{
+	queries.insert (queries.end (), pending.begin (), pending.end ());
+	if (active)
+		queries.push_back (active);
+	if (!queries.empty ())
+		gl::DeleteQueries (queries.size (), queries.data ());
+}
+
+void GPUTimer::Begin (void)
+{
+	if (active)
+		throw std::runtime_error ("GPUTimer::Begin called twice without End.");
+	if (queries.empty ())
+	{
+		queries.push_back (0);
+		gl::GenQueries (1, &queries.back ());
+	}
+	active = queries.back ();
+	queries.pop_back ();
+	gl::BeginQuery (GL_TIME_ELAPSED, active);
+}
+
+void GPUTimer::End (void)
+{
+	if (!active)
+		throw std::runtime_error ("GPUTimer::End called without Begin.");
+	gl::EndQuery (GL_TIME_ELAPSED);
+	pending.push_back (active);
+	active = 0;
+	if (limit && pending.size () > limit)
+	{
+		/* a query whose result was never read can be reused right away */
+		queries.push_back (pending.front ());
+		pending.pop_front ();
+	}
+}
+
+bool GPUTimer::Poll (double &seconds)
+{
+	if (pending.empty ())
+		return false;
+	GLint available = GL_FALSE;
+	gl::GetQueryObjectiv (pending.front (), GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available != GL_TRUE)
+		return false;
+	seconds = Retrieve ();
+	return true;
+}
+
+double GPUTimer::Wait (void)
+{
+	if (pending.empty ())
+		throw std::runtime_error ("GPUTimer::Wait called without a pending measurement.");
+	return Retrieve ();
+}
+
+double GPUTimer::Retrieve (void)
+{
+	GLuint64 nanoseconds = 0;
+	gl::GetQueryObjectui64v (pending.front (), GL_QUERY_RESULT, &nanoseconds);
+	queries.push_back (pending.front ());
+	pending.pop_front ();
+	return nanoseconds * 1e-9;
+}
+
+} /* namespace glutil */
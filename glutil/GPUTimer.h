@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef GLUTIL_GPUTIMER_H
+#define GLUTIL_GPUTIMER_H
+
+#include <oglp/oglp.h>
+#include <deque>
+#include <vector>
+
+namespace glutil {
+
+/*
+ * Measures GPU time with GL_TIME_ELAPSED queries. Measurements are queued, so
+ * results can be read back a few frames later without stalling the pipeline.
+ * Time elapsed queries cannot be nested. With a limit, only that many measurements
+ * are kept pending and older ones are dropped, so a timer that is not polled
+ * every frame does not accumulate queries.
+ */
+class GPUTimer
+{
+public:
+	GPUTimer (size_t limit = 0);
+	GPUTimer (const GPUTimer&) = delete;
+	~GPUTimer (void);
+
+	GPUTimer &operator= (const GPUTimer&) = delete;
+
+	void Begin (void);
+	void End (void);
+	/* retrieves the oldest measurement in seconds, if it is already available */
+	bool Poll (double &seconds);
+	/* waits for the oldest measurement */
+	double Wait (void);
+	bool IsPending (void) const {
+		return !pending.empty ();
+	}
+private:
+	double Retrieve (void);
+	std::vector<GLuint> queries;
+	std::deque<GLuint> pending;
+	GLuint active;
+	size_t limit;
+};
+
+} /* namespace glutil */
+
+#endif /* !defined GLUTIL_GPUTIMER_H */
@@ -22,51 +22,350 @@
  */
 
 #include "LoadProgram.h"
+#include "ProgramBinaryCache.h"
 #include "lz4.h"
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
 
 namespace glutil {
 
-shaderdesc::shaderdesc (const std::string &_name, const GLenum &_type, const shadersource_t &_source)
-        : name (_name), type (_type)
+namespace {
+
+std::mutex sourcecachemutex;
+std::unordered_map<const shadersource_t*, std::shared_ptr<const std::string>> sourcecache;
+
+double GetSeconds (std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+}
+
+/* returns an error message or nullptr on success */
+const char *DecodeShaderSource (const shadersource_t &source, char *dest, const std::string *dictionary)
+{
+    switch (source.codec) {
+    case SHADER_CODEC_RAW:
+        if (source.size != source.length)
+            return "size mismatch.";
+        std::memcpy (dest, source.data, source.length);
+        return nullptr;
+    case SHADER_CODEC_LZ4:
+        if (LZ4_decompress_safe (reinterpret_cast<const char*> (source.data), dest, source.size, source.length)
+                != static_cast<int> (source.length))
+            return "invalid lz4 stream.";
+        return nullptr;
+    case SHADER_CODEC_LZ4_DICT:
+        if (LZ4_decompress_safe_usingDict (reinterpret_cast<const char*> (source.data), dest, source.size,
+                                           source.length, dictionary->data (), dictionary->size ())
+                != static_cast<int> (source.length))
+            return "invalid lz4 stream.";
+        return nullptr;
+    default:
+        return "unknown codec.";
+    }
+}
+
+/* expects sourcecachemutex to be locked */
+std::shared_ptr<const std::string> GetCachedShaderSource (const std::string &name, const shadersource_t &source,
+                                                          double &decodetime)
+{
+    decodetime = 0;
+    auto it = sourcecache.find (&source);
+    if (it != sourcecache.end ())
+        return it->second;
+
+    /* the shared dictionary is decoded once and stays cached next to the shaders */
+    std::shared_ptr<const std::string> dictionary;
+    if (source.codec == SHADER_CODEC_LZ4_DICT) {
+        if (!source.dictionary)
+            throw std::runtime_error (std::string ("Failed to load shader ") + name + ": missing dictionary.");
+        dictionary = GetCachedShaderSource (name, *source.dictionary, decodetime);
+    }
+
+    auto start = std::chrono::steady_clock::now ();
+    std::shared_ptr<std::string> str = std::make_shared<std::string> (source.length, '\0');
+    if (const char *error = DecodeShaderSource (source, &(*str)[0], dictionary.get ()))
+        throw std::runtime_error (std::string ("Failed to load shader ") + name + ": " + error);
+    decodetime += GetSeconds (start);
+    sourcecache[&source] = str;
+    return str;
+}
+
+std::shared_ptr<const std::string> GetShaderSource (const std::string &name, const shadersource_t &source,
+                                                    double &decodetime)
+{
+    const std::lock_guard<std::mutex> lock (sourcecachemutex);
+    return GetCachedShaderSource (name, source, decodetime);
+}
+
+} /* anonymous namespace */
+
+shaderdesc::shaderdesc (const std::string &_name, const GLenum &_type, const shadersource_t &_source, uint64_t _hash)
+        : name (_name), type (_type), decodetime (0), spirv (_source.spirv), spirvsize (_source.spirvsize), hash (_hash)
 {
-    std::vector<char> src;
-    src.resize (_source.length);
-    if (LZ4_decompress_fast (reinterpret_cast<const char*> (_source.data), &src[0], _source.length) < 0)
-        throw std::runtime_error (std::string ("Failed to load shader ") + name + ": invalid lz4 stream.");
-    source = std::string (src.data (), _source.length);
+    source = GetShaderSource (_name, _source, decodetime);
     if (_source.version) version = std::string (_source.version);
 }
 
 shaderdesc::shaderdesc (const std::string &_name, const GLenum &_type, const std::string &_source, const std::string &_version)
-        : name (_name), type (_type), source (_source), version (_version)
+        : name (_name), type (_type), version (_version), source (std::make_shared<const std::string> (_source)),
+          decodetime (0), spirv (nullptr), spirvsize (0), hash (0)
 {
 }
 
+void ClearShaderSourceCache (void)
+{
+    const std::lock_guard<std::mutex> lock (sourcecachemutex);
+    for (auto it = sourcecache.begin (); it != sourcecache.end ();) {
+        if (it->second.use_count () == 1)
+            it = sourcecache.erase (it);
+        else
+            ++it;
+    }
+}
+
+namespace {
+
+bool HasExtension (const char *name)
+{
+    GLint count = 0;
+    gl::GetIntegerv (GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char *extension = reinterpret_cast<const char*> (gl::GetStringi (GL_EXTENSIONS, i));
+        if (extension && !strcmp (extension, name))
+            return true;
+    }
+    return false;
+}
+
+bool HasParallelShaderCompile (void)
+{
+    static const bool supported = [] () {
+        if (!HasExtension ("GL_KHR_parallel_shader_compile"))
+            return false;
+        gl::MaxShaderCompilerThreadsKHR (0xFFFFFFFF);
+        return true;
+    } ();
+    return supported;
+}
+
+bool HasSpirV (void)
+{
+    static const bool supported = [] () {
+        GLint major = 0, minor = 0;
+        gl::GetIntegerv (GL_MAJOR_VERSION, &major);
+        gl::GetIntegerv (GL_MINOR_VERSION, &minor);
+        return major > 4 || (major == 4 && minor >= 6) || HasExtension ("GL_ARB_gl_spirv");
+    } ();
+    return supported;
+}
+
+} /* anonymous namespace */
+
 void LoadProgram (gl::Program &program, const std::string &name, const std::string &definitions,
-        const std::initializer_list<shaderdesc_t> &shaders)
+        const std::initializer_list<shaderdesc_t> &shaders, const ProgramBinaryCache *cache)
+{
+    ProgramLoader loader (cache);
+    loader.Add (program, name, definitions, shaders);
+    loader.Finish ();
+}
+
+ProgramLoader::ProgramLoader (const ProgramBinaryCache *_cache)
+    : cache (_cache), nexthandle (0), parallel (false), usespirv (false)
 {
-    std::vector<gl::Shader> shaderobjs;
-    shaderobjs.reserve (shaders.size ());
-    for (auto &shader : shaders) {
-        shaderobjs.emplace_back (shader.type);
+}
+
+ProgramLoader::~ProgramLoader (void)
+{
+}
+
+size_t ProgramLoader::Add (gl::Program &program, const std::string &name, const std::string &definitions,
+        const shaderdesc_t *shaders, size_t count)
+{
+    size_t handle = nexthandle++;
+    Pending &p = pending.emplace (handle, Pending { &program, name, {}, {}, 0, false, false, {} }).first->second;
+    p.stats.name = name;
+    p.stats.cachelookup = cache && cache->IsSupported ();
+    p.stats.cachehit = false;
+    p.stats.linktime = 0;
+    for (size_t i = 0; i < count; i++) {
+        p.stats.shaders.push_back ({ shaders[i].name, shaders[i].type, shaders[i].GetSource ().size (),
+                                     shaders[i].decodetime, 0 });
+    }
+
+    /* GL cannot link SPIR-V and GLSL shaders into one program and definitions cannot be applied to modules */
+    bool spirv = usespirv && definitions.empty () && HasSpirV ();
+    for (size_t i = 0; i < count; i++)
+        spirv = spirv && shaders[i].spirv;
+
+    if (cache) {
+        std::string keydata (definitions);
+        /* binaries linked from SPIR-V lack uniform names, so they must not be shared with GLSL ones */
+        if (spirv)
+            keydata += std::string (1, '\0') + "spirv";
+        for (size_t i = 0; i < count; i++) {
+            const shaderdesc_t &shader = shaders[i];
+            keydata += '\0' + std::to_string (shader.type) + '\0' + shader.version;
+            /* a different separator keeps build time hashes apart from sources */
+            if (shader.hash)
+                keydata += '\1' + std::to_string (shader.hash);
+            else
+                keydata += '\0' + shader.GetSource ();
+        }
+        p.key = cache->GetKey (keydata);
+        auto start = std::chrono::steady_clock::now ();
+        if (cache->Load (program, p.key)) {
+            p.stats.cachehit = true;
+            p.stats.linktime = GetSeconds (start);
+            p.ready = true;
+            Notify (p);
+            return handle;
+        }
+        program.Parameter (GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    parallel = HasParallelShaderCompile ();
+
+    p.shaders.reserve (count);
+    for (size_t i = 0; i < count; i++) {
+        const shaderdesc_t &shader = shaders[i];
+        p.shaders.emplace_back (shader.type);
+        auto start = std::chrono::steady_clock::now ();
+        if (spirv) {
+            GLuint id = p.shaders.back ().get ();
+            gl::ShaderBinary (1, &id, GL_SHADER_BINARY_FORMAT_SPIR_V, shader.spirv, shader.spirvsize);
+            gl::SpecializeShader (id, "main", 0, nullptr, nullptr);
+            p.stats.shaders[i].compiletime = GetSeconds (start);
+            program.Attach (p.shaders.back ());
+            continue;
+        }
         std::vector<std::string> sources;
         if (!shader.version.empty ()) sources.push_back ("#version " + shader.version + "\n");
         if (!definitions.empty ()) sources.push_back (definitions + "\n");
-        sources.push_back (shader.source);
-        shaderobjs.back ().Source (sources);
+        sources.push_back (shader.GetSource ());
+        p.shaders.back ().Source (sources);
+        start = std::chrono::steady_clock::now ();
+        gl::CompileShader (p.shaders.back ().get ());
+        p.stats.shaders[i].compiletime = GetSeconds (start);
+        program.Attach (p.shaders.back ());
+    }
+    return handle;
+}
+
+bool ProgramLoader::Poll (void)
+{
+    return Update (false);
+}
+
+void ProgramLoader::Finish (void)
+{
+    while (!Update (true));
+}
 
-        if (!shaderobjs.back ().Compile ())
-            throw std::runtime_error ("Failed to compile shader " + shader.name + ": " + shaderobjs.back ().GetInfoLog ());
+void ProgramLoader::Finish (size_t handle)
+{
+    Pending &p = pending.at (handle);
+    while (!p.ready && p.error.empty ()) {
+        try {
+            Advance (p, true);
+        } catch (std::runtime_error &e) {
+            Fail (p, e.what ());
+        }
+    }
+    if (!p.error.empty ())
+        throw std::runtime_error (p.error);
+}
 
-        program.Attach (shaderobjs.back ());
+bool ProgramLoader::Update (bool wait)
+{
+    bool done = true;
+    std::string failure;
+    for (auto &entry : pending) {
+        Pending &p = entry.second;
+        if (p.ready || !p.error.empty ())
+            continue;
+        try {
+            if (!Advance (p, wait))
+                done = false;
+        } catch (std::runtime_error &e) {
+            /* the other programs keep loading; the error is reported once here and stays with the handle */
+            Fail (p, e.what ());
+            if (failure.empty ())
+                failure = p.error;
+        }
     }
+    if (!failure.empty ())
+        throw std::runtime_error (failure);
+    return done;
+}
 
-    if (!program.Link ())
-        throw std::runtime_error ("Failed to link program " + name + ": " + program.GetInfoLog() + ".");
+bool ProgramLoader::Advance (Pending &p, bool wait)
+{
+    if (!p.linking) {
+        if (parallel && !wait) {
+            for (auto &shader : p.shaders) {
+                GLint status = GL_FALSE;
+                gl::GetShaderiv (shader.get (), GL_COMPLETION_STATUS_KHR, &status);
+                if (status != GL_TRUE)
+                    return false;
+            }
+        }
+        for (size_t i = 0; i < p.shaders.size (); i++) {
+            GLint status = GL_FALSE;
+            auto start = std::chrono::steady_clock::now ();
+            gl::GetShaderiv (p.shaders[i].get (), GL_COMPILE_STATUS, &status);
+            p.stats.shaders[i].compiletime += GetSeconds (start);
+            if (status != GL_TRUE)
+                throw std::runtime_error ("Failed to compile shader " + p.stats.shaders[i].name + ": " + p.shaders[i].GetInfoLog ());
+        }
+        auto start = std::chrono::steady_clock::now ();
+        gl::LinkProgram (p.program->get ());
+        p.stats.linktime = GetSeconds (start);
+        p.linking = true;
+        return false;
+    }
 
-    for (auto &obj : shaderobjs) {
-        program.Detach (obj);
+    if (parallel && !wait) {
+        GLint status = GL_FALSE;
+        gl::GetProgramiv (p.program->get (), GL_COMPLETION_STATUS_KHR, &status);
+        if (status != GL_TRUE)
+            return false;
     }
+
+    GLint status = GL_FALSE;
+    auto start = std::chrono::steady_clock::now ();
+    gl::GetProgramiv (p.program->get (), GL_LINK_STATUS, &status);
+    p.stats.linktime += GetSeconds (start);
+    if (status != GL_TRUE)
+        throw std::runtime_error ("Failed to link program " + p.name + ": " + p.program->GetInfoLog() + ".");
+
+    for (auto &obj : p.shaders) {
+        p.program->Detach (obj);
+    }
+    p.shaders.clear ();
+
+    if (cache)
+        cache->Store (*p.program, p.key);
+    p.ready = true;
+    Notify (p);
+    return true;
+}
+
+void ProgramLoader::Fail (Pending &p, const std::string &error)
+{
+    p.error = error;
+    for (auto &obj : p.shaders) {
+        p.program->Detach (obj);
+    }
+    p.shaders.clear ();
+}
+
+void ProgramLoader::Notify (const Pending &p)
+{
+    ProgramListener *listener = GetProgramListener ();
+    if (listener)
+        listener->ProgramLoaded (p.stats);
 }
 
 } /* namespace glutil */
@@ -27,21 +27,120 @@
 #include <string>
 #include <oglp/oglp.h>
 #include <initializer_list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 #include "shader.h"
+#include "ProgramStatistics.h"
 
 namespace glutil {
 
+class ProgramBinaryCache;
+
 typedef struct shaderdesc {
-    shaderdesc (const std::string &name, const GLenum &type, const glutil::shadersource_t &source);
+    /* hash is the <id>_hash constant of a glsl2cpp -i header, which spares hashing the source for cache keys */
+    shaderdesc (const std::string &name, const GLenum &type, const glutil::shadersource_t &source,
+                uint64_t hash = 0);
     shaderdesc (const std::string &name, const GLenum &type, const std::string &source, const std::string &version = std::string ());
+    const std::string &GetSource (void) const {
+        return *source;
+    }
     std::string name;
     GLenum type;
     std::string version;
-    std::string source;
+    /* embedded sources are decompressed once and shared between all descriptions */
+    std::shared_ptr<const std::string> source;
+    double decodetime;
+    /* used instead of the source by loaders that opted in, see ProgramLoader::SetSpirV */
+    const uint8_t *spirv;
+    uint32_t spirvsize;
+    /* FNV-1a hash of the source computed at build time, or 0 */
+    uint64_t hash;
 } shaderdesc_t;
 
+/* releases decompressed embedded sources that are no longer referenced */
+void ClearShaderSourceCache (void);
+
 void LoadProgram (gl::Program &program, const std::string &name, const std::string &definitions,
-                         const std::initializer_list<shaderdesc_t> &shaders);
+                         const std::initializer_list<shaderdesc_t> &shaders,
+                         const ProgramBinaryCache *cache = nullptr);
+
+/*
+ * Submits the shaders of several programs up front and links them as compilation
+ * completes. With GL_KHR_parallel_shader_compile the driver compiles on its own
+ * threads and Poll never blocks; otherwise status queries block as usual.
+ * The programs have to outlive the loader.
+ */
+class ProgramLoader
+{
+public:
+    ProgramLoader (const ProgramBinaryCache *cache = nullptr);
+    ProgramLoader (const ProgramLoader&) = delete;
+    ~ProgramLoader (void);
+
+    ProgramLoader &operator= (const ProgramLoader&) = delete;
+
+    /*
+     * Loads programs from embedded SPIR-V if every shader of the program has it, no
+     * definitions are given and GL_ARB_gl_spirv is supported. SPIR-V programs do not
+     * keep uniform names, so this is off by default.
+     */
+    void SetSpirV (bool enabled) {
+        usespirv = enabled;
+    }
+
+    size_t Add (gl::Program &program, const std::string &name, const std::string &definitions,
+                const std::initializer_list<shaderdesc_t> &shaders) {
+        return Add (program, name, definitions, shaders.begin (), shaders.size ());
+    }
+    size_t Add (gl::Program &program, const std::string &name, const std::string &definitions,
+                const std::vector<shaderdesc_t> &shaders) {
+        return Add (program, name, definitions, shaders.data (), shaders.size ());
+    }
+    /*
+     * advances all pending programs; returns true once all programs are finished.
+     * A failed program is reported once and then counts as finished.
+     */
+    bool Poll (void);
+    void Finish (void);
+    /* waits for a single program only; throws every time if it failed */
+    void Finish (size_t handle);
+    /* forgets a finished or failed program, which keeps Poll proportional to the programs in flight */
+    void Remove (size_t handle) {
+        pending.erase (handle);
+    }
+    bool IsReady (size_t handle) const {
+        return pending.at (handle).ready;
+    }
+    bool HasFailed (size_t handle) const {
+        return !pending.at (handle).error.empty ();
+    }
+    const std::string &GetError (size_t handle) const {
+        return pending.at (handle).error;
+    }
+private:
+    size_t Add (gl::Program &program, const std::string &name, const std::string &definitions,
+                const shaderdesc_t *shaders, size_t count);
+    bool Update (bool wait);
+    typedef struct Pending {
+        gl::Program *program;
+        std::string name;
+        std::vector<gl::Shader> shaders;
+        programstats_t stats;
+        uint64_t key;
+        bool linking;
+        bool ready;
+        std::string error;
+    } Pending;
+    bool Advance (Pending &p, bool wait);
+    void Fail (Pending &p, const std::string &error);
+    void Notify (const Pending &p);
+    const ProgramBinaryCache *cache;
+    std::unordered_map<size_t, Pending> pending;
+    size_t nexthandle;
+    bool parallel;
+    bool usespirv;
+};
 
 } /* namespace glutil */
 
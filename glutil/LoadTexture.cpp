@@ -22,116 +22,129 @@
  */
 
 #include "LoadTexture.h"
+#include "detail/KTX.h"
+#include "lz4.h"
+#include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <future>
 #include <iostream>
+#include <thread>
 
 namespace glutil {
 
-typedef struct {
-	 uint8_t identifier[12];
-	 uint32_t endianness;
-	 uint32_t glType;
-	 uint32_t glTypeSize;
-	 uint32_t glFormat;
-	 uint32_t glInternalFormat;
-	 uint32_t glBaseInternalFormat;
-	 uint32_t pixelWidth;
-	 uint32_t pixelHeight;
-	 uint32_t pixelDepth;
-	 uint32_t numberOfArrayElements;
-	 uint32_t numberOfFaces;
-	 uint32_t numberOfMipmapLevels;
-	 uint32_t bytesOfKeyValueData;
-} ktx_header_t;
-
-const uint8_t ktx_identifier[12] = {
-	0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
-};
-
-GLint StringToWrapMode (const std::string &value)
+using namespace detail;
+
+namespace {
+
+void LoadCompressedLevels (std::istream &stream, const ktx_header_t &header, gl::Texture &texture)
 {
-	if (!value.compare ("CLAMP_TO_EDGE"))
-		return GL_CLAMP_TO_EDGE;
-	else if (!value.compare ("CLAMP_TO_BORDER"))
-		return GL_CLAMP_TO_BORDER;
-	else if (!value.compare ("MIRRORED_REPEAT"))
-		return GL_MIRRORED_REPEAT;
-	else if (!value.compare ("REPEAT"))
-		return GL_REPEAT;
-	else if (!value.compare ("MIRROR_CLAMP_TO_EDGE"))
-		return GL_MIRROR_CLAMP_TO_EDGE;
-	else throw std::runtime_error ("Unable to load texture: invalid texture wrap mode.");
+	typedef struct {
+		uint32_t size;
+		GLintptr offset;
+		std::vector<char> compressed;
+	} image_t;
+	std::vector<image_t> images;
+	images.reserve (header.numberOfMipmapLevels * GetKTXImageCount (header));
+
+	GLintptr total = 0;
+	for (auto level = 0; level < header.numberOfMipmapLevels; level++)
+	{
+		uint32_t size;
+		if (!stream.read (reinterpret_cast<char*> (&size), sizeof (uint32_t)))
+			throw std::runtime_error ("Unable to load texture: cannot read block size");
+		for (auto face = 0; face < GetKTXImageCount (header); face++)
+		{
+			uint32_t compressedsize;
+			if (!stream.read (reinterpret_cast<char*> (&compressedsize), sizeof (uint32_t)))
+				throw std::runtime_error ("Unable to load texture: cannot read compressed block size");
+			images.push_back ({ size, total, std::vector<char> (compressedsize) });
+			if (!stream.read (images.back ().compressed.data (), compressedsize))
+				throw std::runtime_error ("Unable to load texture: cannot read texture data");
+			stream.ignore (3 - ((compressedsize + 3) % 4));
+			total += (size + 3) & ~3;
+		}
+	}
+
+	gl::Buffer data;
+	data.Storage (total, NULL, GL_MAP_WRITE_BIT | GL_CLIENT_STORAGE_BIT);
+#ifndef NDEBUG
+	data.Label ("Temporary texture data buffer.");
+#endif
+	char *ptr = reinterpret_cast<char*> (data.MapRange (0, total, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+	/* decode on a fixed number of workers that take the next image from a shared counter */
+	std::atomic<size_t> next (0);
+	auto decode = [ptr, &images, &next] () {
+		bool valid = true;
+		for (size_t i = next++; i < images.size (); i = next++)
+		{
+			const image_t &image = images[i];
+			valid &= LZ4_decompress_safe (image.compressed.data (), ptr + image.offset, image.compressed.size (),
+										  image.size) == static_cast<int> (image.size);
+		}
+		return valid;
+	};
+	size_t workers = std::max<size_t> (std::min<size_t> (std::thread::hardware_concurrency (), images.size ()), 1);
+	std::vector<std::future<bool>> results;
+	results.reserve (workers - 1);
+	for (size_t i = 1; i < workers; i++)
+		results.emplace_back (std::async (std::launch::async, decode));
+	bool valid = decode ();
+	for (auto &result : results)
+		valid &= result.get ();
+	data.Unmap ();
+	if (!valid)
+		throw std::runtime_error ("Unable to load texture: invalid lz4 stream.");
+	gl::MemoryBarrier (GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+
+	for (auto level = 0; level < header.numberOfMipmapLevels; level++)
+	{
+		for (auto face = 0; face < GetKTXImageCount (header); face++)
+		{
+			const image_t &image = images[level * GetKTXImageCount (header) + face];
+			UploadKTXImage (texture, header, level, level, face, image.size, data, image.offset);
+		}
+	}
 }
 
+} /* anonymous namespace */
+
 gl::Texture LoadTexture (std::istream &stream)
 {
 	ktx_header_t header;
-	if (!stream.read (reinterpret_cast<char*> (&header), sizeof (ktx_header_t)))
-		throw std::runtime_error ("Unable to load texture: cannot read KTX header.");
-	if (memcmp (header.identifier, ktx_identifier, 12) || header.endianness != 0x04030201)
-		throw std::runtime_error ("Unable to load texture: invalid file format.");
-
-	if (header.pixelDepth != 0 || header.numberOfArrayElements != 0
-        || (header.numberOfFaces != 1 && header.numberOfFaces != 6))
-		throw std::runtime_error ("Unable to load texture: format currently unsupported");
+	ReadKTXHeader (stream, header);
 
-	gl::Texture texture ((header.numberOfFaces > 1) ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D);
+	gl::Texture texture (GetKTXTarget (header));
 
+	GLsizei levels = header.numberOfMipmapLevels;
+	bool generatemipmaps = false;
 	if (header.numberOfMipmapLevels == 0)
 	{
-        std::cerr << "Automatic mipmap generation currently doesn't work. Falling back to linear filtering." << std::endl;
 		header.numberOfMipmapLevels = 1;
+		if (header.glType)
+		{
+			levels = GetKTXMipmapCount (header);
+			generatemipmaps = true;
+		}
+		else
+		{
+			std::cerr << "Cannot generate mipmaps for compressed textures. Falling back to linear filtering." << std::endl;
+			levels = 1;
+		}
 	}
 
-    texture.Storage2D (header.numberOfMipmapLevels, header.glInternalFormat, header.pixelWidth, header.pixelHeight);
-    if (header.numberOfFaces > 1) {
-        texture.Parameter (GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-        texture.Parameter (GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        texture.Parameter (GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    }
+    AllocateKTXStorage (texture, header, levels);
 
-    {
-		int32_t read = 0;
-		while (read < header.bytesOfKeyValueData)
-		{
-			uint32_t size = 0;
-			std::vector<char> data;
-			if (!stream.read (reinterpret_cast<char*> (&size), sizeof (uint32_t)))
-				throw std::runtime_error ("Unable to load texture: cannot read key value data size.");
-			data.resize (size + 1);
-			if (!stream.read (data.data (), size))
-				throw std::runtime_error ("Unable to load texture: cannot read key value data.");
-			data[size] = 0;
-			std::string key (data.data ());
-			if (!key.compare ("WRAP_S"))
-			{
-				if (key.size () < size)
-				{
-					std::string value (&data[key.size () + 1]);
-                    texture.Parameter (GL_TEXTURE_WRAP_S, StringToWrapMode (value));
-				}
-			}
-			else if (!key.compare ("WRAP_T"))
-			{
-				if (key.size () < size)
-				{
-					std::string value (&data[key.size () + 1]);
-                    texture.Parameter (GL_TEXTURE_WRAP_T, StringToWrapMode (value));
-				}
-			}
-			else if (!key.compare ("WRAP_R"))
-			{
-				if (key.size () < size)
-				{
-					std::string value (&data[key.size () + 1]);
-                    texture.Parameter (GL_TEXTURE_WRAP_R, StringToWrapMode (value));
-				}
-			}
+	ktx_keyvalues_t keyvalues;
+	ReadKTXKeyValueData (stream, header, keyvalues);
+	SetKTXParameters (texture, header, keyvalues);
 
-			size_t skip = 3 - ((size + 3) % 4);
-			if (skip) stream.ignore (skip);
-			read += sizeof (uint32_t) + size + skip;
-		}
+	if (IsKTXSupercompressed (keyvalues))
+	{
+		LoadCompressedLevels (stream, header, texture);
+		if (generatemipmaps)
+			texture.GenerateMipmap ();
+		return texture;
 	}
 
 	gl::Buffer data;
@@ -148,41 +161,13 @@ gl::Texture LoadTexture (std::istream &stream)
 			data.Label ("Temporary texture data buffer.");
 #endif
 		}
-		for (auto face = 0; face < header.numberOfFaces; face++)
+		for (auto face = 0; face < GetKTXImageCount (header); face++)
 		{
-			void *ptr = data.MapRange (0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-			stream.read (reinterpret_cast<char*> (ptr), size);
-			data.Unmap ();
-			if (!stream) throw std::runtime_error ("Unable to load texture: cannot read texture data");
-			gl::MemoryBarrier (GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
-
-			data.Bind (GL_PIXEL_UNPACK_BUFFER);
-			if (header.glType)
-			{
-                if (header.numberOfFaces > 1) {
-                    texture.SubImage3D (level, 0, 0, 0, header.pixelWidth >> level, header.pixelHeight >> level, face,
-                                        header.glFormat, header.glType, NULL);
-                } else {
-                    texture.SubImage2D (level, 0, 0, header.pixelWidth >> level, header.pixelHeight >> level,
-                                        header.glFormat, header.glType, NULL);
-                }
-			}
-			else
-			{
-                if (header.numberOfFaces > 1) {
-                    texture.CompressedSubImage3D (level, 0, 0, 0, header.pixelWidth >> level,
-                                                  header.pixelHeight >> level, header.glInternalFormat,
-                                                  face, size, NULL);
-                } else {
-                    texture.CompressedSubImage2D (level, 0, 0, header.pixelWidth >> level,
-                                                  header.pixelHeight >> level, header.glInternalFormat,
-                                                  size, NULL);
-                }
-			}
-			gl::Buffer::Unbind (GL_PIXEL_UNPACK_BUFFER);
+			ReadKTXImage (stream, data, size);
+			UploadKTXImage (texture, header, level, level, face, size, data);
 			{
 				uint32_t skip = ((size + 3) & ~3) - size;
-				if (face < header.numberOfFaces - 1 && skip > 0)
+				if (face < GetKTXImageCount (header) - 1 && skip > 0)
 				{
 					stream.ignore (skip);
 				}
@@ -191,6 +176,10 @@ gl::Texture LoadTexture (std::istream &stream)
 
 		stream.ignore (3 - ((size + 3) % 4));
 	}
+
+	if (generatemipmaps)
+		texture.GenerateMipmap ();
+
 	return texture;
 }
 
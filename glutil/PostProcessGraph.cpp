@@ -0,0 +1,365 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "PostProcessGraph.h"
+#include <set>
+#include <stdexcept>
+
+namespace glutil {
+
+namespace {
+
+/* measurements kept per pass while they are not polled */
+const size_t timinglimit = 8;
+
+} /* anonymous namespace */
+
+PostProcessGraph::PostProcessGraph (void) : compiled (false), timing (false)
+{
+}
+
+PostProcessGraph::~PostProcessGraph (void)
+{
+}
+
+PostProcessGraph::resource_t PostProcessGraph::CreateTarget (GLenum format, GLsizei width, GLsizei height)
+{
+	resources.push_back ({ TRANSIENT, format, width, height, nullptr, 0 });
+	compiled = false;
+	return resources.size () - 1;
+}
+
+PostProcessGraph::resource_t PostProcessGraph::ImportTexture (const gl::Texture &texture, GLsizei width,
+															  GLsizei height)
+{
+	resources.push_back ({ TEXTURE, GL_NONE, width, height, &texture, 0 });
+	compiled = false;
+	return resources.size () - 1;
+}
+
+PostProcessGraph::resource_t PostProcessGraph::ImportFramebuffer (GLuint framebuffer, GLsizei width,
+																  GLsizei height)
+{
+	resources.push_back ({ FRAMEBUFFER, GL_NONE, width, height, nullptr, framebuffer });
+	compiled = false;
+	return resources.size () - 1;
+}
+
+PostProcessGraph::pass_t PostProcessGraph::AddPass (const std::string &name, const gl::Program &fragment,
+													const std::vector<resource_t> &inputs,
+													const std::vector<resource_t> &outputs,
+													const setup_t &setup)
+{
+	GLint separable = GL_FALSE;
+	gl::GetProgramiv (fragment.get (), GL_PROGRAM_SEPARABLE, &separable);
+	if (separable != GL_TRUE)
+		throw std::runtime_error ("Post-processing pass " + name + " uses a program that is not separable.");
+	if (outputs.empty ())
+		throw std::runtime_error ("Post-processing pass " + name + " has no outputs.");
+	for (auto &input : inputs)
+	{
+		if (input >= resources.size ())
+			throw std::runtime_error ("Post-processing pass " + name + " reads an invalid resource.");
+		if (resources[input].type == FRAMEBUFFER)
+			throw std::runtime_error ("Post-processing pass " + name + " reads a framebuffer.");
+	}
+	for (auto &output : outputs)
+	{
+		if (output >= resources.size ())
+			throw std::runtime_error ("Post-processing pass " + name + " writes an invalid resource.");
+		if (resources[output].type == FRAMEBUFFER && outputs.size () > 1)
+			throw std::runtime_error ("Post-processing pass " + name
+									  + " writes a framebuffer together with other outputs.");
+		if (resources[output].width != resources[outputs[0]].width
+			|| resources[output].height != resources[outputs[0]].height)
+			throw std::runtime_error ("Post-processing pass " + name + " writes outputs of different sizes.");
+		for (auto &input : inputs)
+		{
+			if (input == output)
+				throw std::runtime_error ("Post-processing pass " + name + " reads its own output.");
+		}
+	}
+
+	passes.push_back ({ name, &fragment, inputs, outputs, setup, nullptr });
+	compiled = false;
+	return passes.size () - 1;
+}
+
+std::vector<PostProcessGraph::pass_t> PostProcessGraph::Sort (void) const
+{
+	std::vector<std::vector<pass_t>> writers (resources.size ());
+	for (pass_t p = 0; p < passes.size (); p++)
+	{
+		for (auto &output : passes[p].outputs)
+			writers[output].push_back (p);
+	}
+
+	// a pass depends on every writer of its inputs; writers of the same
+	// resource run in the order they were added
+	std::vector<std::set<pass_t>> successors (passes.size ());
+	for (pass_t p = 0; p < passes.size (); p++)
+	{
+		for (auto &input : passes[p].inputs)
+		{
+			for (auto &writer : writers[input])
+				successors[writer].insert (p);
+		}
+	}
+	for (auto &list : writers)
+	{
+		for (size_t i = 1; i < list.size (); i++)
+			successors[list[i - 1]].insert (list[i]);
+	}
+
+	std::vector<size_t> indegree (passes.size (), 0);
+	for (auto &list : successors)
+	{
+		for (auto &successor : list)
+			indegree[successor]++;
+	}
+	std::set<pass_t> ready;
+	for (pass_t p = 0; p < passes.size (); p++)
+	{
+		if (!indegree[p])
+			ready.insert (p);
+	}
+
+	std::vector<pass_t> order;
+	order.reserve (passes.size ());
+	while (!ready.empty ())
+	{
+		// prefer a pass with the same outputs as the previous one, so that
+		// both can be drawn without binding another framebuffer
+		auto it = ready.begin ();
+		if (!order.empty ())
+		{
+			for (auto candidate = ready.begin (); candidate != ready.end (); candidate++)
+			{
+				if (passes[*candidate].outputs == passes[order.back ()].outputs)
+				{
+					it = candidate;
+					break;
+				}
+			}
+		}
+		pass_t p = *it;
+		ready.erase (it);
+		order.push_back (p);
+		for (auto &successor : successors[p])
+		{
+			if (!--indegree[successor])
+				ready.insert (successor);
+		}
+	}
+	if (order.size () != passes.size ())
+		throw std::runtime_error ("The post-processing graph contains a cycle.");
+	return order;
+}
+
+void PostProcessGraph::Allocate (const std::vector<pass_t> &order)
+{
+	framebuffers.clear ();
+	textures.clear ();
+
+	std::vector<size_t> lastuse (resources.size (), 0);
+	for (size_t i = 0; i < order.size (); i++)
+	{
+		for (auto &input : passes[order[i]].inputs)
+			lastuse[input] = i;
+		for (auto &output : passes[order[i]].outputs)
+			lastuse[output] = i;
+	}
+
+	for (auto &resource : resources)
+	{
+		if (resource.type == TRANSIENT)
+			resource.texture = nullptr;
+	}
+
+	// transient targets whose lifetime has ended hand their texture to the
+	// next target of the same format and size
+	std::vector<resource_t> available;
+	for (size_t i = 0; i < order.size (); i++)
+	{
+		const passinfo_t &pass = passes[order[i]];
+		for (auto &input : pass.inputs)
+		{
+			if (!resources[input].texture)
+				throw std::runtime_error ("Post-processing pass " + pass.name
+										  + " reads a target before it is written.");
+		}
+		for (auto &output : pass.outputs)
+		{
+			resourceinfo_t &resource = resources[output];
+			if (resource.type != TRANSIENT || resource.texture)
+				continue;
+			for (auto it = available.begin (); it != available.end (); it++)
+			{
+				const resourceinfo_t &previous = resources[*it];
+				if (previous.format == resource.format && previous.width == resource.width
+					&& previous.height == resource.height)
+				{
+					resource.texture = previous.texture;
+					available.erase (it);
+					break;
+				}
+			}
+			if (!resource.texture)
+			{
+				textures.emplace_back (new gl::Texture (GL_TEXTURE_2D));
+				gl::Texture &texture = *textures.back ();
+				texture.Storage2D (1, resource.format, resource.width, resource.height);
+				texture.Parameter (GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+				texture.Parameter (GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				texture.Parameter (GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+				texture.Parameter (GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+#ifndef NDEBUG
+				texture.Label ("Post-processing target.");
+#endif
+				resource.texture = &texture;
+			}
+		}
+		for (size_t r = 0; r < resources.size (); r++)
+		{
+			if (resources[r].type == TRANSIENT && resources[r].texture && lastuse[r] == i)
+				available.push_back (r);
+		}
+	}
+}
+
+GLuint PostProcessGraph::GetFramebuffer (const std::vector<const gl::Texture*> &attachments)
+{
+	std::vector<GLuint> key;
+	key.reserve (attachments.size ());
+	for (auto &attachment : attachments)
+		key.push_back (attachment->get ());
+
+	std::unique_ptr<gl::Framebuffer> &framebuffer = framebuffers[key];
+	if (!framebuffer)
+	{
+		framebuffer.reset (new gl::Framebuffer);
+		std::vector<GLenum> drawbuffers;
+		for (size_t i = 0; i < attachments.size (); i++)
+		{
+			framebuffer->Texture (GL_COLOR_ATTACHMENT0 + i, *attachments[i], 0);
+			drawbuffers.push_back (GL_COLOR_ATTACHMENT0 + i);
+		}
+		framebuffer->DrawBuffers (drawbuffers.size (), drawbuffers.data ());
+#ifndef NDEBUG
+		framebuffer->Label ("Post-processing framebuffer.");
+#endif
+	}
+	return framebuffer->get ();
+}
+
+void PostProcessGraph::Compile (void)
+{
+	std::vector<pass_t> order = Sort ();
+	Allocate (order);
+
+	batches.clear ();
+	for (auto &p : order)
+	{
+		const passinfo_t &pass = passes[p];
+		const resourceinfo_t &target = resources[pass.outputs[0]];
+		GLuint framebuffer;
+		if (target.type == FRAMEBUFFER)
+			framebuffer = target.framebuffer;
+		else
+		{
+			std::vector<const gl::Texture*> attachments;
+			for (auto &output : pass.outputs)
+				attachments.push_back (resources[output].texture);
+			framebuffer = GetFramebuffer (attachments);
+		}
+		if (batches.empty () || batches.back ().framebuffer != framebuffer)
+			batches.push_back ({ framebuffer, target.width, target.height, { } });
+		batches.back ().passes.push_back (p);
+	}
+	compiled = true;
+}
+
+void PostProcessGraph::Execute (StateCache &state)
+{
+	if (!compiled)
+		Compile ();
+
+	/* the cache cannot know about GL calls made since the last execution */
+	state.Invalidate ();
+	GLint framebuffer = 0, viewport[4];
+	gl::GetIntegerv (GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+	gl::GetIntegerv (GL_VIEWPORT, viewport);
+
+	ScopedCapability depthtest (GL_DEPTH_TEST, false, state);
+	state.UseProgram (0);
+	GLsizei width = -1, height = -1;
+	for (auto &batch : batches)
+	{
+		state.BindFramebuffer (GL_DRAW_FRAMEBUFFER, batch.framebuffer);
+		if (batch.width != width || batch.height != height)
+		{
+			width = batch.width;
+			height = batch.height;
+			gl::Viewport (0, 0, width, height);
+		}
+		for (auto &p : batch.passes)
+		{
+			passinfo_t &pass = passes[p];
+			state.BindProgramPipeline (pipelines.GetFullscreen (*pass.fragment).get ());
+			for (size_t i = 0; i < pass.inputs.size (); i++)
+				state.BindTextureUnit (i, resources[pass.inputs[i]].texture->get ());
+			if (pass.setup)
+				pass.setup ();
+			if (timing && !pass.timer)
+				pass.timer.reset (new GPUTimer (timinglimit));
+			if (timing)
+				pass.timer->Begin ();
+			fsquad.Render (state);
+			if (timing)
+				pass.timer->End ();
+		}
+	}
+
+	state.BindFramebuffer (GL_DRAW_FRAMEBUFFER, framebuffer);
+	if (width != viewport[2] || height != viewport[3] || viewport[0] || viewport[1])
+		gl::Viewport (viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void PostProcessGraph::SetTiming (bool enabled)
+{
+	timing = enabled;
+	if (!timing)
+	{
+		for (auto &pass : passes)
+			pass.timer.reset ();
+	}
+}
+
+bool PostProcessGraph::PollTiming (pass_t pass, double &seconds)
+{
+	if (pass >= passes.size () || !passes[pass].timer)
+		return false;
+	return passes[pass].timer->Poll (seconds);
+}
+
+} /* namespace glutil */
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef GLUTIL_POSTPROCESSGRAPH_H
+#define GLUTIL_POSTPROCESSGRAPH_H
+
+#include <oglp/oglp.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "FullscreenQuad.h"
+#include "GPUTimer.h"
+#include "ProgramPipelineCache.h"
+#include "StateCache.h"
+
+namespace glutil {
+
+/*
+ * Executes a chain of fullscreen passes. Each pass is a separable fragment program
+ * that reads textures and writes color targets; the graph orders the passes by
+ * their dependencies, lets transient targets with disjoint lifetimes share storage
+ * and draws consecutive passes with the same targets into one framebuffer bind.
+ * Inputs are bound to texture units in the order they are declared, outputs to
+ * color attachments in the order they are declared. The programs have to be
+ * separable and outlive the graph. Execution restores the draw framebuffer and
+ * the viewport.
+ */
+class PostProcessGraph
+{
+public:
+	typedef size_t resource_t;
+	typedef size_t pass_t;
+	/*
+	 * called after the pipeline and the inputs are bound, e.g. to set uniforms,
+	 * which have to be set with glProgramUniform since no program is in use
+	 */
+	typedef std::function<void (void)> setup_t;
+
+	PostProcessGraph (void);
+	PostProcessGraph (const PostProcessGraph&) = delete;
+	~PostProcessGraph (void);
+
+	PostProcessGraph &operator= (const PostProcessGraph&) = delete;
+
+	/* a target that is allocated by the graph and only valid while it executes */
+	resource_t CreateTarget (GLenum format, GLsizei width, GLsizei height);
+	/* a texture owned by the caller that can be read or written by passes */
+	resource_t ImportTexture (const gl::Texture &texture, GLsizei width, GLsizei height);
+	/* a framebuffer owned by the caller, e.g. 0 for the default framebuffer */
+	resource_t ImportFramebuffer (GLuint framebuffer, GLsizei width, GLsizei height);
+
+	pass_t AddPass (const std::string &name, const gl::Program &fragment,
+					const std::vector<resource_t> &inputs, const std::vector<resource_t> &outputs,
+					const setup_t &setup = setup_t ());
+
+	/* orders the passes and assigns storage; called by Execute if anything changed */
+	void Compile (void);
+	void Execute (StateCache &state = StateCache::GetCurrent ());
+
+	/*
+	 * measures every pass with a GPUTimer from the next execution on; only the
+	 * last few measurements of each pass are kept until they are polled
+	 */
+	void SetTiming (bool enabled);
+	/* retrieves the oldest measurement of a pass in seconds, if it is already available */
+	bool PollTiming (pass_t pass, double &seconds);
+
+	/* number of textures allocated for transient targets */
+	size_t GetTransientTextureCount (void) const {
+		return textures.size ();
+	}
+	/* number of framebuffer binds per execution */
+	size_t GetBatchCount (void) const {
+		return batches.size ();
+	}
+private:
+	typedef enum {
+		TRANSIENT,
+		TEXTURE,
+		FRAMEBUFFER
+	} resourcetype_t;
+	typedef struct resource {
+		resourcetype_t type;
+		GLenum format;
+		GLsizei width, height;
+		/* assigned on compilation for transient targets */
+		const gl::Texture *texture;
+		GLuint framebuffer;
+	} resourceinfo_t;
+	typedef struct pass {
+		std::string name;
+		const gl::Program *fragment;
+		std::vector<resource_t> inputs;
+		std::vector<resource_t> outputs;
+		setup_t setup;
+		std::unique_ptr<GPUTimer> timer;
+	} passinfo_t;
+	typedef struct batch {
+		GLuint framebuffer;
+		GLsizei width, height;
+		std::vector<pass_t> passes;
+	} batch_t;
+	std::vector<pass_t> Sort (void) const;
+	void Allocate (const std::vector<pass_t> &order);
+	GLuint GetFramebuffer (const std::vector<const gl::Texture*> &attachments);
+	std::vector<resourceinfo_t> resources;
+	std::vector<passinfo_t> passes;
+	std::vector<batch_t> batches;
+	std::vector<std::unique_ptr<gl::Texture>> textures;
+	std::map<std::vector<GLuint>, std::unique_ptr<gl::Framebuffer>> framebuffers;
+	FullscreenQuad fsquad;
+	ProgramPipelineCache pipelines;
+	bool compiled;
+	bool timing;
+};
+
+} /* namespace glutil */
+
+#endif /* !defined GLUTIL_POSTPROCESSGRAPH_H */
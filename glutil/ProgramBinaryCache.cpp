@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "ProgramBinaryCache.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <unistd.h>
+
+namespace glutil {
+
+namespace {
+
+const uint32_t cache_magic = 0x42504C47; /* "GLPB" */
+
+uint64_t Hash (const void *data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL)
+{
+	const uint8_t *ptr = reinterpret_cast<const uint8_t*> (data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= ptr[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+uint64_t HashString (const GLubyte *str, uint64_t hash)
+{
+	if (str == nullptr)
+		return hash;
+	const char *s = reinterpret_cast<const char*> (str);
+	return Hash (s, strlen (s) + 1, hash);
+}
+
+/* unique within the process; combined with the pid it is unique across processes */
+std::atomic<unsigned long> tmpcounter (0);
+
+} /* anonymous namespace */
+
+ProgramBinaryCache::ProgramBinaryCache (const std::string &_directory) : directory (_directory), driverhash (0)
+{
+	if (!directory.empty () && directory.back () != '/')
+		directory += '/';
+
+	GLint formats = 0;
+	gl::GetIntegerv (GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	supported = formats > 0;
+
+	driverhash = HashString (gl::GetString (GL_VENDOR), Hash (nullptr, 0));
+	driverhash = HashString (gl::GetString (GL_RENDERER), driverhash);
+	driverhash = HashString (gl::GetString (GL_VERSION), driverhash);
+}
+
+ProgramBinaryCache::~ProgramBinaryCache (void)
+{
+}
+
+uint64_t ProgramBinaryCache::GetKey (const std::string &data) const
+{
+	return Hash (data.data (), data.size (), driverhash);
+}
+
+std::string ProgramBinaryCache::GetFilename (uint64_t key) const
+{
+	char name[17];
+	snprintf (name, sizeof (name), "%016llx", static_cast<unsigned long long> (key));
+	return directory + name + ".bin";
+}
+
+bool ProgramBinaryCache::Load (gl::Program &program, uint64_t key) const
+{
+	if (!supported)
+		return false;
+
+	std::ifstream in (GetFilename (key).c_str (), std::ios_base::in | std::ios_base::binary);
+	if (!in.is_open ())
+		return false;
+
+	uint32_t magic;
+	uint64_t storedkey;
+	uint32_t format;
+	uint32_t length;
+	in.seekg (0, std::ios_base::end);
+	std::streamoff filesize = in.tellg ();
+	in.seekg (0, std::ios_base::beg);
+	if (filesize < 0)
+		return false;
+
+	if (!in.read (reinterpret_cast<char*> (&magic), sizeof (uint32_t))
+		|| !in.read (reinterpret_cast<char*> (&storedkey), sizeof (uint64_t))
+		|| !in.read (reinterpret_cast<char*> (&format), sizeof (uint32_t))
+		|| !in.read (reinterpret_cast<char*> (&length), sizeof (uint32_t)))
+		return false;
+	if (magic != cache_magic || storedkey != key)
+		return false;
+	if (std::streamoff (length) > filesize - std::streamoff (in.tellg ()))
+		return false;
+
+	std::vector<char> binary (length);
+	if (!in.read (binary.data (), length))
+		return false;
+
+	gl::ProgramBinary (program.get (), format, binary.data (), GLsizei (length));
+	GLint status = GL_FALSE;
+	gl::GetProgramiv (program.get (), GL_LINK_STATUS, &status);
+	return status == GL_TRUE;
+}
+
+void ProgramBinaryCache::Store (const gl::Program &program, uint64_t key) const
+{
+	if (!supported)
+		return;
+
+	GLint length = 0;
+	gl::GetProgramiv (program.get (), GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> binary (length);
+	GLenum format = 0;
+	gl::GetProgramBinary (program.get (), length, &length, &format, binary.data ());
+
+	std::string filename = GetFilename (key);
+	std::string tmpfilename = filename + "." + std::to_string (getpid ()) + "."
+		+ std::to_string (tmpcounter++) + ".tmp";
+	{
+		std::ofstream out (tmpfilename.c_str (), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+		if (!out.is_open ())
+			return;
+		uint32_t format32 = format;
+		uint32_t length32 = length;
+		out.write (reinterpret_cast<const char*> (&cache_magic), sizeof (uint32_t));
+		out.write (reinterpret_cast<const char*> (&key), sizeof (uint64_t));
+		out.write (reinterpret_cast<const char*> (&format32), sizeof (uint32_t));
+		out.write (reinterpret_cast<const char*> (&length32), sizeof (uint32_t));
+		out.write (binary.data (), length);
+		if (!out)
+		{
+			out.close ();
+			std::remove (tmpfilename.c_str ());
+			return;
+		}
+	}
+	if (std::rename (tmpfilename.c_str (), filename.c_str ()))
+		std::remove (tmpfilename.c_str ());
+}
+
+} /* namespace glutil */
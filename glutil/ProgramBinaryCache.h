@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef GLUTIL_PROGRAMBINARYCACHE_H
+#define GLUTIL_PROGRAMBINARYCACHE_H
+
+#include <oglp/oglp.h>
+#include <string>
+#include <stdint.h>
+
+namespace glutil {
+
+/*
+ * Stores linked program binaries in a directory. Keys are derived from the
+ * program sources and the GL vendor, renderer and version strings, so entries
+ * of other drivers are never loaded. A GL context has to be current on construction.
+ */
+class ProgramBinaryCache
+{
+public:
+	ProgramBinaryCache (const std::string &directory);
+	ProgramBinaryCache (const ProgramBinaryCache&) = delete;
+	~ProgramBinaryCache (void);
+
+	ProgramBinaryCache &operator= (const ProgramBinaryCache&) = delete;
+
+	uint64_t GetKey (const std::string &data) const;
+	bool Load (gl::Program &program, uint64_t key) const;
+	void Store (const gl::Program &program, uint64_t key) const;
+
+	bool IsSupported (void) const {
+		return supported;
+	}
+private:
+	std::string GetFilename (uint64_t key) const;
+	std::string directory;
+	uint64_t driverhash;
+	bool supported;
+};
+
+} /* namespace glutil */
+
+#endif /* !defined GLUTIL_PROGRAMBINARYCACHE_H */
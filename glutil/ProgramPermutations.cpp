@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "ProgramPermutations.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace glutil {
+
+ProgramPermutations::ProgramPermutations (const std::string &_name,
+										  const std::initializer_list<std::string> &_features,
+										  const std::initializer_list<shaderdesc_t> &_shaders,
+										  const std::string &_definitions, const ProgramBinaryCache *_cache)
+	: name (_name), features (_features), shaders (_shaders), definitions (_definitions), cache (_cache)
+{
+	if (features.size () > 64)
+		throw std::runtime_error ("Too many features for program " + name + ".");
+}
+
+ProgramPermutations::~ProgramPermutations (void)
+{
+}
+
+uint64_t ProgramPermutations::GetMask (const std::string &feature) const
+{
+	for (size_t i = 0; i < features.size (); i++)
+	{
+		if (!features[i].compare (feature))
+			return uint64_t (1) << i;
+	}
+	throw std::runtime_error ("Unknown feature " + feature + " for program " + name + ".");
+}
+
+ProgramPermutations::Variant &ProgramPermutations::Submit (uint64_t variant)
+{
+	auto it = variants.find (variant);
+	if (it != variants.end ())
+		return it->second;
+
+	if (!loader)
+		loader.reset (new ProgramLoader (cache));
+
+	std::string defs (definitions);
+	for (size_t i = 0; i < features.size (); i++)
+	{
+		if (variant & (uint64_t (1) << i))
+		{
+			if (!defs.empty ()) defs += "\n";
+			defs += "#define " + features[i];
+		}
+	}
+
+	Variant &v = variants[variant];
+	v.program.reset (new gl::Program);
+	v.handle = loader->Add (*v.program, name + "[" + std::to_string (variant) + "]", defs, shaders);
+	v.loaded = false;
+	submitted.push_back (variant);
+	return v;
+}
+
+const gl::Program &ProgramPermutations::Get (uint64_t variant)
+{
+	Variant &v = Submit (variant);
+	/* other prewarmed variants keep compiling in the background */
+	if (!v.loaded)
+	{
+		/* a failed variant stays with the loader, so that it throws again */
+		loader->Finish (v.handle);
+		loader->Remove (v.handle);
+		v.loaded = true;
+		submitted.erase (std::find (submitted.begin (), submitted.end (), variant));
+	}
+	return *v.program;
+}
+
+void ProgramPermutations::Prewarm (uint64_t variant)
+{
+	Submit (variant);
+}
+
+bool ProgramPermutations::Poll (void)
+{
+	if (!loader)
+		return true;
+	bool done = loader->Poll ();
+	/* finished variants are released from the loader, failed ones are kept for Get */
+	for (auto it = submitted.begin (); it != submitted.end ();)
+	{
+		Variant &v = variants[*it];
+		if (loader->IsReady (v.handle))
+		{
+			loader->Remove (v.handle);
+			v.loaded = true;
+			it = submitted.erase (it);
+		}
+		else
+			++it;
+	}
+	return done;
+}
+
+bool ProgramPermutations::IsLoaded (uint64_t variant) const
+{
+	auto it = variants.find (variant);
+	return it != variants.end () && (it->second.loaded || loader->IsReady (it->second.handle));
+}
+
+} /* namespace glutil */
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef GLUTIL_PROGRAMPERMUTATIONS_H
+#define GLUTIL_PROGRAMPERMUTATIONS_H
+
+#include <oglp/oglp.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "LoadProgram.h"
+
+namespace glutil {
+
+/*
+ * Compiles variants of a program lazily. Each feature key corresponds to a bit
+ * in the variant mask and is passed to the shaders as a preprocessor definition.
+ * Variants can be prewarmed; prewarmed variants are compiled while Poll is
+ * called and are finished on demand by Get, which only waits for the requested
+ * variant. A variant that fails to build is reported once by Poll and every time
+ * it is requested by Get.
+ */
+class ProgramPermutations
+{
+public:
+	ProgramPermutations (const std::string &name, const std::initializer_list<std::string> &features,
+						 const std::initializer_list<shaderdesc_t> &shaders,
+						 const std::string &definitions = std::string (),
+						 const ProgramBinaryCache *cache = nullptr);
+	ProgramPermutations (const ProgramPermutations&) = delete;
+	~ProgramPermutations (void);
+
+	ProgramPermutations &operator= (const ProgramPermutations&) = delete;
+
+	uint64_t GetMask (const std::string &feature) const;
+	const gl::Program &Get (uint64_t variant);
+	void Prewarm (uint64_t variant);
+	bool Poll (void);
+	bool IsLoaded (uint64_t variant) const;
+private:
+	typedef struct Variant {
+		std::unique_ptr<gl::Program> program;
+		size_t handle;
+		/* set once the handle has been removed from the loader */
+		bool loaded;
+	} Variant;
+	Variant &Submit (uint64_t variant);
+	std::string name;
+	std::vector<std::string> features;
+	std::vector<shaderdesc_t> shaders;
+	std::string definitions;
+	std::unordered_map<uint64_t, Variant> variants;
+	/* variants that are still held by the loader */
+	std::vector<uint64_t> submitted;
+	std::unique_ptr<ProgramLoader> loader;
+	const ProgramBinaryCache *cache;
+};
+
+} /* namespace glutil */
+
+#endif /* !defined GLUTIL_PROGRAMPERMUTATIONS_H */
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "ProgramPipelineCache.h"
+
+namespace glutil {
+
+ProgramPipelineCache::ProgramPipelineCache (void)
+{
+}
+
+ProgramPipelineCache::~ProgramPipelineCache (void)
+{
+}
+
+const gl::ProgramPipeline &ProgramPipelineCache::Get (const std::initializer_list<stage_t> &stages)
+{
+	std::vector<std::pair<GLbitfield, GLuint>> key;
+	key.reserve (stages.size ());
+	for (auto &stage : stages)
+		key.emplace_back (stage.first, stage.second->get ());
+
+	std::unique_ptr<gl::ProgramPipeline> &pipeline = pipelines[key];
+	if (!pipeline)
+	{
+		pipeline.reset (new gl::ProgramPipeline);
+		for (auto &stage : stages)
+			pipeline->UseStages (stage.first, *stage.second);
+#ifndef NDEBUG
+		pipeline->Label ("Cached program pipeline.");
+#endif
+	}
+	return *pipeline;
+}
+
+const gl::ProgramPipeline &ProgramPipelineCache::GetFullscreen (const gl::Program &fragment)
+{
+	return Get ({ { GL_VERTEX_SHADER_BIT, &fsquad.GetVertexProgram () }, { GL_FRAGMENT_SHADER_BIT, &fragment } });
+}
+
+void ProgramPipelineCache::Clear (void)
+{
+	pipelines.clear ();
+}
+
+} /* namespace glutil */
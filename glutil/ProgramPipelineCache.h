@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef GLUTIL_PROGRAMPIPELINECACHE_H
+#define GLUTIL_PROGRAMPIPELINECACHE_H
+
+#include <oglp/oglp.h>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "FullscreenQuad.h"
+
+namespace glutil {
+
+/*
+ * Combines separable programs into program pipelines and caches them by stage set,
+ * so that e.g. many fragment passes can share the fullscreen quad vertex program
+ * instead of relinking it into every program. Pipelines are keyed by program names,
+ * so the cache has to be cleared when any of the programs is destroyed.
+ */
+class ProgramPipelineCache
+{
+public:
+	typedef std::pair<GLbitfield, const gl::Program*> stage_t;
+
+	ProgramPipelineCache (void);
+	ProgramPipelineCache (const ProgramPipelineCache&) = delete;
+	~ProgramPipelineCache (void);
+
+	ProgramPipelineCache &operator= (const ProgramPipelineCache&) = delete;
+
+	const gl::ProgramPipeline &Get (const std::initializer_list<stage_t> &stages);
+	/* pipeline of the fullscreen quad vertex program and the given separable fragment program */
+	const gl::ProgramPipeline &GetFullscreen (const gl::Program &fragment);
+	void Clear (void);
+private:
+	FullscreenQuad fsquad;
+	std::map<std::vector<std::pair<GLbitfield, GLuint>>, std::unique_ptr<gl::ProgramPipeline>> pipelines;
+};
+
+} /* namespace glutil */
+
+#endif /* !defined GLUTIL_PROGRAMPIPELINECACHE_H */
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "ProgramStatistics.h"
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+
+namespace glutil {
+
+namespace {
+
+std::atomic<ProgramListener*> listener (nullptr);
+
+const char *GetStageName (GLenum type)
+{
+    switch (type) {
+    case GL_VERTEX_SHADER: return "vertex";
+    case GL_TESS_CONTROL_SHADER: return "tess control";
+    case GL_TESS_EVALUATION_SHADER: return "tess evaluation";
+    case GL_GEOMETRY_SHADER: return "geometry";
+    case GL_FRAGMENT_SHADER: return "fragment";
+    case GL_COMPUTE_SHADER: return "compute";
+    default: return "unknown";
+    }
+}
+
+} /* anonymous namespace */
+
+double programstats::GetTotalTime (void) const
+{
+    double total = linktime;
+    for (auto &shader : shaders)
+        total += shader.decodetime + shader.compiletime;
+    return total;
+}
+
+void SetProgramListener (ProgramListener *_listener)
+{
+    listener = _listener;
+}
+
+ProgramListener *GetProgramListener (void)
+{
+    return listener;
+}
+
+ProgramStatistics::ProgramStatistics (void)
+{
+}
+
+ProgramStatistics::~ProgramStatistics (void)
+{
+}
+
+void ProgramStatistics::ProgramLoaded (const programstats_t &stats)
+{
+    const std::lock_guard<std::mutex> lock (mutex);
+    programs.push_back (stats);
+}
+
+std::vector<programstats_t> ProgramStatistics::GetStatistics (void) const
+{
+    const std::lock_guard<std::mutex> lock (mutex);
+    return programs;
+}
+
+void ProgramStatistics::Clear (void)
+{
+    const std::lock_guard<std::mutex> lock (mutex);
+    programs.clear ();
+}
+
+void ProgramStatistics::Dump (std::ostream &out, size_t count) const
+{
+    std::vector<programstats_t> sorted = GetStatistics ();
+    std::sort (sorted.begin (), sorted.end (), [] (const programstats_t &a, const programstats_t &b) {
+        return a.GetTotalTime () > b.GetTotalTime ();
+    });
+
+    double total = 0, decode = 0, compile = 0, link = 0;
+    size_t hits = 0, misses = 0, sourcesize = 0;
+    for (auto &program : sorted) {
+        total += program.GetTotalTime ();
+        link += program.linktime;
+        if (program.cachehit) hits++;
+        else if (program.cachelookup) misses++;
+        for (auto &shader : program.shaders) {
+            decode += shader.decodetime;
+            compile += shader.compiletime;
+            sourcesize += shader.sourcesize;
+        }
+    }
+
+    std::ios_base::fmtflags flags = out.flags ();
+    std::streamsize precision = out.precision ();
+    out << std::fixed << std::setprecision (3)
+        << "Loaded " << sorted.size () << " programs in " << total * 1000.0 << " ms ("
+        << hits << " binary cache hits, " << misses << " misses)" << std::endl
+        << "  decode " << decode * 1000.0 << " ms, compile " << compile * 1000.0 << " ms, link "
+        << link * 1000.0 << " ms, " << sourcesize << " bytes of source" << std::endl;
+
+    for (size_t i = 0; i < sorted.size () && i < count; i++) {
+        const programstats_t &program = sorted[i];
+        out << "  " << program.name << ": " << program.GetTotalTime () * 1000.0 << " ms"
+            << (program.cachehit ? " (cached)" : "") << ", link " << program.linktime * 1000.0 << " ms" << std::endl;
+        for (auto &shader : program.shaders) {
+            out << "    " << shader.name << " [" << GetStageName (shader.type) << "]: "
+                << shader.sourcesize << " bytes, decode " << shader.decodetime * 1000.0
+                << " ms, compile " << shader.compiletime * 1000.0 << " ms" << std::endl;
+        }
+    }
+    out.flags (flags);
+    out.precision (precision);
+}
+
+} /* namespace glutil */
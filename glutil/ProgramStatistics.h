@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef GLUTIL_PROGRAMSTATISTICS_H
+#define GLUTIL_PROGRAMSTATISTICS_H
+
+#include <oglp/oglp.h>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace glutil {
+
+typedef struct shaderstats {
+    std::string name;
+    GLenum type;
+    size_t sourcesize;
+    /* seconds spent decompressing the embedded source, zero if it was cached */
+    double decodetime;
+    /* seconds spent blocking in the driver for compilation */
+    double compiletime;
+} shaderstats_t;
+
+typedef struct programstats {
+    std::string name;
+    /* whether a ProgramBinaryCache was consulted and whether it had the binary */
+    bool cachelookup;
+    bool cachehit;
+    double linktime;
+    std::vector<shaderstats_t> shaders;
+    double GetTotalTime (void) const;
+} programstats_t;
+
+class ProgramListener
+{
+public:
+    virtual ~ProgramListener (void) { }
+    virtual void ProgramLoaded (const programstats_t &stats) = 0;
+};
+
+/* the listener is notified of every program loaded by LoadProgram or ProgramLoader */
+void SetProgramListener (ProgramListener *listener);
+ProgramListener *GetProgramListener (void);
+
+/* collects the statistics of all loaded programs */
+class ProgramStatistics : public ProgramListener
+{
+public:
+    ProgramStatistics (void);
+    ~ProgramStatistics (void);
+    void ProgramLoaded (const programstats_t &stats) override;
+    std::vector<programstats_t> GetStatistics (void) const;
+    /* writes a summary with the slowest programs first */
+    void Dump (std::ostream &out, size_t count = 20) const;
+    void Clear (void);
+private:
+    mutable std::mutex mutex;
+    std::vector<programstats_t> programs;
+};
+
+} /* namespace glutil */
+
+#endif /* !defined GLUTIL_PROGRAMSTATISTICS_H */
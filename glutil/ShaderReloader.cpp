@@ -0,0 +1,346 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "ShaderReloader.h"
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+namespace glutil {
+
+namespace {
+
+std::string GetDirectory (const std::string &filename)
+{
+	size_t pos = filename.find_last_of ('/');
+	if (pos == std::string::npos)
+		return std::string ();
+	return filename.substr (0, pos + 1);
+}
+
+long long GetModificationTime (const std::string &filename)
+{
+	struct stat st;
+	if (stat (filename.c_str (), &st))
+		return -1;
+	return st.st_mtime;
+}
+
+/* whether a line ends inside a block comment, given whether it starts inside one */
+bool EndsInComment (const std::string &str, bool comment)
+{
+	for (size_t i = 0; i + 1 < str.size (); i++)
+	{
+		if (comment)
+		{
+			if (str[i] == '*' && str[i + 1] == '/')
+			{
+				comment = false;
+				i++;
+			}
+		}
+		else if (str[i] == '/' && str[i + 1] == '/')
+			break;
+		else if (str[i] == '/' && str[i + 1] == '*')
+		{
+			comment = true;
+			i++;
+		}
+	}
+	return comment;
+}
+
+} /* anonymous namespace */
+
+ShaderReloader::ShaderReloader (const std::vector<std::string> &_incdirs) : fd (-1)
+{
+	for (auto &dir : _incdirs)
+	{
+		incdirs.push_back (dir);
+		if (!incdirs.back ().empty () && incdirs.back ().back () != '/')
+			incdirs.back () += '/';
+	}
+#ifdef __linux__
+	fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0)
+		std::cerr << "Cannot initialize inotify. Falling back to polling shader files." << std::endl;
+#endif
+}
+
+ShaderReloader::~ShaderReloader (void)
+{
+#ifdef __linux__
+	if (fd >= 0)
+		close (fd);
+#endif
+}
+
+void ShaderReloader::Watch (gl::Program &program, const std::string &name, const std::string &definitions,
+							const std::initializer_list<shaderfile_t> &shaderfiles)
+{
+	watched.push_back ({ &program, name, definitions, shaderfiles, std::set<std::string> () });
+	Watched &w = watched.back ();
+	/* a program that is broken from the start is watched as well, so that it can be fixed on disk */
+	for (auto &file : w.files)
+		w.dependencies.insert (file.second);
+	try {
+		std::vector<shaderdesc_t> shaders = Load (w, w.dependencies);
+		ProgramLoader loader;
+		loader.Add (program, name, definitions, shaders);
+		loader.Finish ();
+	} catch (std::exception &e) {
+		std::cerr << "Loading " << name << " failed: " << e.what () << std::endl;
+	}
+	for (auto &dependency : w.dependencies)
+		AddWatch (dependency);
+}
+
+bool ShaderReloader::Preprocess (const std::string &filename, bool searchinc, std::string &version,
+								 std::string &data, std::set<std::string> &dependencies,
+								 std::set<std::string> &once, unsigned int &sourcestring) const
+{
+	std::string path = filename;
+	std::ifstream in (path.c_str (), std::ios_base::in);
+	if (!in.is_open () && searchinc)
+	{
+		for (auto &dir : incdirs)
+		{
+			path = dir + filename;
+			in.open (path.c_str (), std::ios_base::in);
+			if (in.is_open ())
+				break;
+		}
+	}
+	if (!in.is_open ())
+	{
+		std::cerr << "Cannot open " << filename << "." << std::endl;
+		return false;
+	}
+	dependencies.insert (path);
+	unsigned int mysourcestring = sourcestring++;
+	if (once.count (path))
+		return true;
+
+	/* directives are handled by the same rules as in glsl2cpp: only at the start
+	 * of a line outside of block comments, and #pragma once skips repeated includes */
+	unsigned int line = 1;
+	bool comment = false;
+	std::string str;
+	while (std::getline (in, str))
+	{
+		line++;
+		bool directive = !comment;
+		comment = EndsInComment (str, comment);
+		size_t start = str.find_first_not_of (" \t");
+		std::string trimmed = start == std::string::npos ? std::string () : str.substr (start);
+		if (!directive)
+		{
+			data += str + "\n";
+			continue;
+		}
+		if (!trimmed.compare (0, 9, "#version "))
+		{
+			version = trimmed.substr (9);
+		}
+		else if (!trimmed.compare (0, 12, "#pragma once")
+				 && (trimmed.size () == 12 || isspace (trimmed[12])))
+		{
+			once.insert (path);
+		}
+		else if (!trimmed.compare (0, 9, "#include "))
+		{
+			std::string includefile = trimmed.substr (9);
+			while (!includefile.empty () && (isspace (includefile.front ()) || includefile.front () == '\"'
+											 || includefile.front () == '<'))
+				includefile.erase (0, 1);
+			while (!includefile.empty () && (isspace (includefile.back ()) || includefile.back () == '\"'
+											 || includefile.back () == '>'))
+				includefile.pop_back ();
+			if (!Preprocess (includefile, true, version, data, dependencies, once, sourcestring))
+				return false;
+		}
+		else
+		{
+			data += str + "\n";
+			continue;
+		}
+		data += "#line " + std::to_string (line) + " " + std::to_string (mysourcestring) + "\n";
+	}
+	return true;
+}
+
+std::vector<shaderdesc_t> ShaderReloader::Load (const Watched &w, std::set<std::string> &dependencies) const
+{
+	std::vector<shaderdesc_t> shaders;
+	for (auto &file : w.files)
+	{
+		std::string version, data;
+		std::set<std::string> once;
+		unsigned int sourcestring = 0;
+		if (!Preprocess (file.second, false, version, data, dependencies, once, sourcestring))
+			throw std::runtime_error ("Failed to load shader " + file.second + ".");
+		shaders.emplace_back (file.second, file.first, data, version);
+	}
+	return shaders;
+}
+
+void ShaderReloader::AddWatch (const std::string &filename)
+{
+	for (auto &file : files)
+	{
+		if (!file.first.compare (filename))
+			return;
+	}
+	files.emplace_back (filename, GetModificationTime (filename));
+
+#ifdef __linux__
+	if (fd < 0)
+		return;
+	std::string dir = GetDirectory (filename);
+	for (auto &watchdir : watchdirs)
+	{
+		if (!watchdir.second.compare (dir))
+			return;
+	}
+	int wd = inotify_add_watch (fd, dir.empty () ? "." : dir.c_str (), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+	if (wd >= 0)
+		watchdirs.emplace_back (wd, dir);
+#endif
+}
+
+std::set<std::string> ShaderReloader::GetModified (void)
+{
+	std::set<std::string> modified;
+#ifdef __linux__
+	if (fd >= 0)
+	{
+		alignas (struct inotify_event) char buffer[4096];
+		ssize_t len;
+		while ((len = read (fd, buffer, sizeof (buffer))) > 0)
+		{
+			for (char *ptr = buffer; ptr < buffer + len;)
+			{
+				const struct inotify_event *event = reinterpret_cast<const struct inotify_event*> (ptr);
+				if (event->len > 0)
+				{
+					for (auto &watchdir : watchdirs)
+					{
+						if (watchdir.first == event->wd)
+							modified.insert (watchdir.second + event->name);
+					}
+				}
+				ptr += sizeof (struct inotify_event) + event->len;
+			}
+		}
+		return modified;
+	}
+#endif
+	for (auto &file : files)
+	{
+		long long mtime = GetModificationTime (file.first);
+		if (mtime != file.second)
+		{
+			file.second = mtime;
+			modified.insert (file.first);
+		}
+	}
+	return modified;
+}
+
+/* keeps watching files that a failed reload started to include */
+void ShaderReloader::Merge (Watched &w, const std::set<std::string> &dependencies)
+{
+	for (auto &dependency : dependencies)
+	{
+		if (w.dependencies.insert (dependency).second)
+			AddWatch (dependency);
+	}
+}
+
+void ShaderReloader::Submit (size_t index)
+{
+	const Watched &w = watched[index];
+	Reload reload;
+	reload.index = index;
+	try {
+		std::vector<shaderdesc_t> shaders = Load (w, reload.dependencies);
+		reload.program.reset (new gl::Program);
+		GLint separable = GL_FALSE;
+		gl::GetProgramiv (w.program->get (), GL_PROGRAM_SEPARABLE, &separable);
+		reload.program->Parameter (GL_PROGRAM_SEPARABLE, separable);
+		reload.loader.reset (new ProgramLoader);
+		reload.loader->Add (*reload.program, w.name, w.definitions, shaders);
+	} catch (std::exception &e) {
+		std::cerr << "Reloading " << w.name << " failed: " << e.what () << std::endl;
+		Merge (watched[index], reload.dependencies);
+		return;
+	}
+	reloads.emplace_back (std::move (reload));
+}
+
+void ShaderReloader::Update (void)
+{
+	std::set<std::string> modified = GetModified ();
+	if (!modified.empty ())
+	{
+		for (size_t i = 0; i < watched.size (); i++)
+		{
+			for (auto &dependency : watched[i].dependencies)
+			{
+				if (modified.count (dependency))
+				{
+					Submit (i);
+					break;
+				}
+			}
+		}
+	}
+
+	for (auto it = reloads.begin (); it != reloads.end ();)
+	{
+		try {
+			if (!it->loader->Poll ())
+			{
+				++it;
+				continue;
+			}
+			Watched &w = watched[it->index];
+			*w.program = std::move (*it->program);
+			w.dependencies = std::move (it->dependencies);
+			for (auto &dependency : w.dependencies)
+				AddWatch (dependency);
+			std::cerr << "Reloaded " << w.name << "." << std::endl;
+		} catch (std::exception &e) {
+			std::cerr << "Reloading " << watched[it->index].name << " failed: " << e.what () << std::endl;
+			Merge (watched[it->index], it->dependencies);
+		}
+		it = reloads.erase (it);
+	}
+}
+
+} /* namespace glutil */
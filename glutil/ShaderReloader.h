@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef GLUTIL_SHADERRELOADER_H
+#define GLUTIL_SHADERRELOADER_H
+
+#include <oglp/oglp.h>
+#include <initializer_list>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "LoadProgram.h"
+
+namespace glutil {
+
+/*
+ * Development helper that loads programs from GLSL files instead of embedded sources
+ * and recompiles a program whenever one of its files or their transitive includes
+ * changes. Includes are resolved like glsl2cpp does. Compilation is submitted in Update
+ * and the program is only replaced after it linked successfully; errors are reported
+ * on std::cerr and the previous program is kept. A program that fails to load in Watch
+ * is reported the same way and still watched, so it can be fixed while running. Files
+ * are watched with inotify on Linux and by polling modification times elsewhere. The
+ * programs have to outlive the reloader.
+ */
+class ShaderReloader
+{
+public:
+	typedef std::pair<GLenum, std::string> shaderfile_t;
+
+	ShaderReloader (const std::vector<std::string> &incdirs = std::vector<std::string> ());
+	ShaderReloader (const ShaderReloader&) = delete;
+	~ShaderReloader (void);
+
+	ShaderReloader &operator= (const ShaderReloader&) = delete;
+
+	void Watch (gl::Program &program, const std::string &name, const std::string &definitions,
+				const std::initializer_list<shaderfile_t> &files);
+	/* checks for modified files, submits recompilation and swaps finished programs */
+	void Update (void);
+private:
+	typedef struct Watched {
+		gl::Program *program;
+		std::string name;
+		std::string definitions;
+		std::vector<shaderfile_t> files;
+		std::set<std::string> dependencies;
+	} Watched;
+	typedef struct Reload {
+		size_t index;
+		std::unique_ptr<gl::Program> program;
+		std::unique_ptr<ProgramLoader> loader;
+		std::set<std::string> dependencies;
+	} Reload;
+	std::vector<shaderdesc_t> Load (const Watched &watched, std::set<std::string> &dependencies) const;
+	bool Preprocess (const std::string &filename, bool searchinc, std::string &version, std::string &data,
+					 std::set<std::string> &dependencies, std::set<std::string> &once,
+					 unsigned int &sourcestring) const;
+	void AddWatch (const std::string &filename);
+	void Merge (Watched &w, const std::set<std::string> &dependencies);
+	void Submit (size_t index);
+	std::set<std::string> GetModified (void);
+	std::vector<std::string> incdirs;
+	std::vector<Watched> watched;
+	std::vector<Reload> reloads;
+	std::vector<std::pair<std::string, long long>> files;
+	int fd;
+	std::vector<std::pair<int, std::string>> watchdirs;
+};
+
+} /* namespace glutil */
+
+#endif /* !defined GLUTIL_SHADERRELOADER_H */
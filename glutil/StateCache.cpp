@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "StateCache.h"
+#include "ContextRegistry.h"
+#include <stdexcept>
+
+namespace glutil {
+
+StateCache::StateCache (void)
+{
+}
+
+StateCache::~StateCache (void)
+{
+}
+
+StateCache &StateCache::GetCurrent (void)
+{
+	return ContextRegistry::GetCurrent ().GetStateCache ();
+}
+
+bool StateCache::IsEnabled (GLenum cap)
+{
+	auto it = caps.find (cap);
+	if (it == caps.end ())
+		it = caps.emplace (cap, gl::IsEnabled (cap) == GL_TRUE).first;
+	return it->second;
+}
+
+void StateCache::SetEnabled (GLenum cap, bool enabled)
+{
+	auto it = caps.find (cap);
+	if (it != caps.end () && it->second == enabled)
+		return;
+	if (enabled)
+		gl::Enable (cap);
+	else
+		gl::Disable (cap);
+	caps[cap] = enabled;
+}
+
+void StateCache::BindVertexArray (GLuint name)
+{
+	if (vertexarray.Set (name))
+		gl::BindVertexArray (name);
+}
+
+void StateCache::UseProgram (GLuint name)
+{
+	if (program.Set (name))
+		gl::UseProgram (name);
+}
+
+void StateCache::BindProgramPipeline (GLuint name)
+{
+	if (pipeline.Set (name))
+		gl::BindProgramPipeline (name);
+}
+
+void StateCache::BindFramebuffer (GLenum target, GLuint name)
+{
+	switch (target)
+	{
+	case GL_FRAMEBUFFER:
+		if (drawframebuffer.valid && readframebuffer.valid
+			&& drawframebuffer.name == name && readframebuffer.name == name)
+			return;
+		drawframebuffer.Set (name);
+		readframebuffer.Set (name);
+		break;
+	case GL_DRAW_FRAMEBUFFER:
+		if (!drawframebuffer.Set (name))
+			return;
+		break;
+	case GL_READ_FRAMEBUFFER:
+		if (!readframebuffer.Set (name))
+			return;
+		break;
+	default:
+		throw std::runtime_error ("Invalid framebuffer target.");
+	}
+	gl::BindFramebuffer (target, name);
+}
+
+void StateCache::BindTextureUnit (GLuint unit, GLuint name)
+{
+	if (unit >= textures.size ())
+		textures.resize (unit + 1);
+	if (textures[unit].Set (name))
+		gl::BindTextureUnit (unit, name);
+}
+
+void StateCache::Invalidate (void)
+{
+	caps.clear ();
+	vertexarray = binding_t ();
+	program = binding_t ();
+	pipeline = binding_t ();
+	drawframebuffer = binding_t ();
+	readframebuffer = binding_t ();
+	textures.clear ();
+}
+
+} /* namespace glutil */
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef GLUTIL_STATECACHE_H
+#define GLUTIL_STATECACHE_H
+
+#include <oglp/oglp.h>
+#include <unordered_map>
+#include <vector>
+
+namespace glutil {
+
+/*
+ * Shadows a small part of the GL state, so that redundant enables and binds are
+ * skipped. Capabilities are queried from GL the first time they are needed;
+ * bindings are unknown until they are first set. Code that changes the shadowed
+ * state directly has to call Invalidate afterwards.
+ */
+class StateCache
+{
+public:
+	StateCache (void);
+	StateCache (const StateCache&) = delete;
+	~StateCache (void);
+
+	StateCache &operator= (const StateCache&) = delete;
+
+	/* the cache of the current ContextRegistry */
+	static StateCache &GetCurrent (void);
+
+	bool IsEnabled (GLenum cap);
+	void Enable (GLenum cap) {
+		SetEnabled (cap, true);
+	}
+	void Disable (GLenum cap) {
+		SetEnabled (cap, false);
+	}
+	void SetEnabled (GLenum cap, bool enabled);
+
+	void BindVertexArray (GLuint vertexarray);
+	void UseProgram (GLuint program);
+	void BindProgramPipeline (GLuint pipeline);
+	/* GL_FRAMEBUFFER sets both the draw and the read framebuffer */
+	void BindFramebuffer (GLenum target, GLuint framebuffer);
+	void BindTextureUnit (GLuint unit, GLuint texture);
+
+	/* forgets all shadowed state */
+	void Invalidate (void);
+	/* forgets the shadowed state of a single capability */
+	void Invalidate (GLenum cap) {
+		caps.erase (cap);
+	}
+private:
+	typedef struct binding {
+		binding (void) : valid (false), name (0) { }
+		/* returns true if the binding changes */
+		bool Set (GLuint _name) {
+			if (valid && name == _name)
+				return false;
+			valid = true;
+			name = _name;
+			return true;
+		}
+		bool valid;
+		GLuint name;
+	} binding_t;
+	std::unordered_map<GLenum, bool> caps;
+	binding_t vertexarray;
+	binding_t program;
+	binding_t pipeline;
+	binding_t drawframebuffer;
+	binding_t readframebuffer;
+	std::vector<binding_t> textures;
+};
+
+/*
+ * restores a capability to the state it had on construction; the previous state is
+ * queried from GL rather than taken from the cache, since it may have been changed
+ * directly
+ */
+class ScopedCapability
+{
+public:
+	ScopedCapability (GLenum _cap, bool enabled, StateCache &_cache = StateCache::GetCurrent ())
+		: cache (_cache), cap (_cap) {
+		cache.Invalidate (cap);
+		previous = cache.IsEnabled (cap);
+		cache.SetEnabled (cap, enabled);
+	}
+	ScopedCapability (const ScopedCapability&) = delete;
+	~ScopedCapability (void) {
+		cache.SetEnabled (cap, previous);
+	}
+
+	ScopedCapability &operator= (const ScopedCapability&) = delete;
+private:
+	StateCache &cache;
+	GLenum cap;
+	bool previous;
+};
+
+} /* namespace glutil */
+
+#endif /* !defined GLUTIL_STATECACHE_H */
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "StreamingTexture.h"
+#include <stdexcept>
+
+namespace glutil {
+
+using namespace detail;
+
+namespace {
+
+ktx_header_t ReadHeader (std::istream &stream)
+{
+	ktx_header_t header;
+	ReadKTXHeader (stream, header);
+	return header;
+}
+
+} /* anonymous namespace */
+
+StreamingTexture::StreamingTexture (std::istream &_stream)
+	: stream (&_stream), header (ReadHeader (_stream)), texture (GetKTXTarget (header)), buffersize (0),
+	  first (0), base (0)
+{
+	if (header.numberOfMipmapLevels == 0)
+		header.numberOfMipmapLevels = 1;
+	ReadKTXKeyValueData (*stream, header, keyvalues);
+	if (IsKTXSupercompressed (keyvalues))
+		throw std::runtime_error ("Unable to stream texture: supercompressed textures cannot be streamed.");
+
+	offsets.reserve (header.numberOfMipmapLevels);
+	sizes.reserve (header.numberOfMipmapLevels);
+	for (auto level = 0; level < header.numberOfMipmapLevels; level++)
+	{
+		uint32_t size;
+		if (!stream->read (reinterpret_cast<char*> (&size), sizeof (uint32_t)))
+			throw std::runtime_error ("Unable to load texture: cannot read block size");
+		offsets.push_back (stream->tellg ());
+		sizes.push_back (size);
+		if (!stream->seekg (GetKTXImageCount (header) * ((size + 3) & ~3), std::ios_base::cur))
+			throw std::runtime_error ("Unable to load texture: cannot seek texture data");
+	}
+
+	base = sizes.size ();
+	Reallocate (0);
+	Stream (1);
+}
+
+StreamingTexture::StreamingTexture (StreamingTexture &&t)
+	: stream (t.stream), header (t.header), keyvalues (std::move (t.keyvalues)), offsets (std::move (t.offsets)),
+	  sizes (std::move (t.sizes)), texture (std::move (t.texture)), buffer (std::move (t.buffer)),
+	  buffersize (t.buffersize), first (t.first), base (t.base)
+{
+	t.stream = nullptr;
+	t.buffersize = 0;
+}
+
+StreamingTexture::~StreamingTexture (void)
+{
+}
+
+StreamingTexture &StreamingTexture::operator= (StreamingTexture &&t)
+{
+	stream = t.stream; t.stream = nullptr;
+	header = t.header;
+	keyvalues = std::move (t.keyvalues);
+	offsets = std::move (t.offsets);
+	sizes = std::move (t.sizes);
+	texture = std::move (t.texture);
+	buffer = std::move (t.buffer);
+	buffersize = t.buffersize; t.buffersize = 0;
+	first = t.first;
+	base = t.base;
+	return *this;
+}
+
+bool StreamingTexture::Stream (unsigned int levels)
+{
+	unsigned int target = base - std::min (levels, base);
+	/* storage for all new levels is allocated at once, so resident levels are copied only once */
+	if (target < first)
+		Reallocate (target);
+	while (base > target)
+	{
+		UploadLevel (base - 1);
+		base--;
+		texture.Parameter (GL_TEXTURE_BASE_LEVEL, GLint (base - first));
+	}
+	return base > 0;
+}
+
+void StreamingTexture::Evict (unsigned int levels)
+{
+	unsigned int newbase = std::min<unsigned int> (base + levels, sizes.size () - 1);
+	if (newbase <= base)
+		return;
+	base = newbase;
+	Reallocate (newbase);
+}
+
+unsigned long StreamingTexture::GetAllocatedSize (void) const
+{
+	unsigned long size = 0;
+	for (auto level = first; level < sizes.size (); level++)
+		size += GetKTXImageCount (header) * sizes[level];
+	return size;
+}
+
+void StreamingTexture::Reallocate (unsigned int newfirst)
+{
+	GLenum target = GetKTXTarget (header);
+	gl::Texture newtexture (target);
+	AllocateKTXStorage (newtexture, header, sizes.size () - newfirst, newfirst);
+	SetKTXParameters (newtexture, header, keyvalues);
+
+	for (auto level = std::max (base, newfirst); level < sizes.size (); level++)
+	{
+		gl::CopyImageSubData (texture.get (), target, level - first, 0, 0, 0,
+							  newtexture.get (), target, level - newfirst, 0, 0, 0,
+							  GetKTXLevelWidth (header, level), GetKTXLevelHeight (header, level),
+							  GetKTXLevelDepth (header, level));
+	}
+
+	texture = std::move (newtexture);
+	first = newfirst;
+	if (base < sizes.size ())
+		texture.Parameter (GL_TEXTURE_BASE_LEVEL, GLint (base - first));
+}
+
+void StreamingTexture::UploadLevel (unsigned int level)
+{
+	uint32_t size = sizes[level];
+	if (size > buffersize)
+	{
+		buffer = gl::Buffer ();
+		buffer.Storage (size, NULL, GL_MAP_WRITE_BIT | GL_CLIENT_STORAGE_BIT);
+#ifndef NDEBUG
+		buffer.Label ("Streaming texture data buffer.");
+#endif
+		buffersize = size;
+	}
+
+	stream->clear ();
+	if (!stream->seekg (offsets[level]))
+		throw std::runtime_error ("Unable to load texture: cannot seek texture data");
+	for (auto face = 0; face < GetKTXImageCount (header); face++)
+	{
+		ReadKTXImage (*stream, buffer, size);
+		UploadKTXImage (texture, header, level - first, level, face, size, buffer);
+		uint32_t skip = ((size + 3) & ~3) - size;
+		if (skip > 0)
+			stream->ignore (skip);
+	}
+}
+
+} /* namespace glutil */
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef GLUTIL_STREAMINGTEXTURE_H
+#define GLUTIL_STREAMINGTEXTURE_H
+
+#include <oglp/oglp.h>
+#include <istream>
+#include <vector>
+#include "detail/KTX.h"
+
+namespace glutil {
+
+/*
+ * Loads a KTX texture progressively: the coarsest mipmap level is uploaded
+ * on construction and finer levels are streamed in by subsequent calls to Stream.
+ * The stream has to stay valid and seekable for the lifetime of the object.
+ * Evicting levels reallocates the texture, so GetTexture has to be queried again
+ * after Stream or Evict.
+ */
+class StreamingTexture
+{
+public:
+	StreamingTexture (std::istream &stream);
+	StreamingTexture (const StreamingTexture&) = delete;
+	StreamingTexture (StreamingTexture &&texture);
+	~StreamingTexture (void);
+
+	StreamingTexture &operator= (const StreamingTexture&) = delete;
+	StreamingTexture &operator= (StreamingTexture &&texture);
+
+	/* uploads up to the given number of finer mipmap levels; returns false once complete */
+	bool Stream (unsigned int levels = 1);
+	/* drops up to the given number of the finest resident mipmap levels */
+	void Evict (unsigned int levels = 1);
+
+	const gl::Texture &GetTexture (void) const {
+		return texture;
+	}
+	const unsigned int &GetBaseLevel (void) const {
+		return base;
+	}
+	unsigned int GetLevelCount (void) const {
+		return sizes.size ();
+	}
+	bool IsComplete (void) const {
+		return base == 0;
+	}
+	unsigned long GetAllocatedSize (void) const;
+private:
+	void Reallocate (unsigned int first);
+	void UploadLevel (unsigned int level);
+	std::istream *stream;
+	detail::ktx_header_t header;
+	detail::ktx_keyvalues_t keyvalues;
+	std::vector<std::streampos> offsets;
+	std::vector<uint32_t> sizes;
+	gl::Texture texture;
+	gl::Buffer buffer;
+	uint32_t buffersize;
+	/* the file level stored in level 0 of the texture */
+	unsigned int first;
+	/* the finest resident file level */
+	unsigned int base;
+};
+
+} /* namespace glutil */
+
+#endif /* !defined GLUTIL_STREAMINGTEXTURE_H */
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "TextureArrayBuilder.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace glutil {
+
+using namespace detail;
+
+TextureArrayBuilder::TextureArrayBuilder (void)
+{
+}
+
+TextureArrayBuilder::~TextureArrayBuilder (void)
+{
+}
+
+GLint TextureArrayBuilder::Add (std::istream &stream)
+{
+	ktx_header_t h;
+	ReadKTXHeader (stream, h);
+	if (h.numberOfArrayElements != 0 || h.pixelDepth != 0)
+		throw std::runtime_error ("Unable to add texture to array: texture already has layers.");
+	GetKTXTarget (h);
+	if (h.numberOfMipmapLevels == 0)
+		h.numberOfMipmapLevels = 1;
+
+	/* every file has to be checked, since any of them could be supercompressed */
+	ktx_keyvalues_t kv;
+	ReadKTXKeyValueData (stream, h, kv);
+	if (IsKTXSupercompressed (kv))
+		throw std::runtime_error ("Unable to add texture to array: supercompressed textures are unsupported.");
+
+	if (layers.empty ())
+	{
+		header = h;
+		keyvalues = std::move (kv);
+	}
+	else if (h.glType != header.glType || h.glFormat != header.glFormat
+			 || h.glInternalFormat != header.glInternalFormat || h.pixelWidth != header.pixelWidth
+			 || h.pixelHeight != header.pixelHeight || h.numberOfFaces != header.numberOfFaces
+			 || h.numberOfMipmapLevels != header.numberOfMipmapLevels)
+		throw std::runtime_error ("Unable to add texture to array: format or size mismatch.");
+
+	std::vector<std::vector<char>> levels (h.numberOfMipmapLevels);
+	for (auto level = 0; level < h.numberOfMipmapLevels; level++)
+	{
+		uint32_t size;
+		if (!stream.read (reinterpret_cast<char*> (&size), sizeof (uint32_t)))
+			throw std::runtime_error ("Unable to load texture: cannot read block size");
+		levels[level].resize (size * h.numberOfFaces);
+		for (auto face = 0; face < h.numberOfFaces; face++)
+		{
+			if (!stream.read (&levels[level][face * size], size))
+				throw std::runtime_error ("Unable to load texture: cannot read texture data");
+			uint32_t skip = ((size + 3) & ~3) - size;
+			if (skip > 0)
+				stream.ignore (skip);
+		}
+	}
+	layers.emplace_back (std::move (levels));
+	return layers.size () - 1;
+}
+
+gl::Texture TextureArrayBuilder::Build (void) const
+{
+	if (layers.empty ())
+		throw std::runtime_error ("Unable to build texture array: no textures were added.");
+
+	ktx_header_t h = header;
+	h.numberOfArrayElements = layers.size ();
+
+	gl::Texture texture (GetKTXTarget (h));
+	AllocateKTXStorage (texture, h, h.numberOfMipmapLevels);
+	SetKTXParameters (texture, h, keyvalues);
+
+	gl::Buffer data;
+	data.Storage (layers[0][0].size (), NULL, GL_MAP_WRITE_BIT | GL_CLIENT_STORAGE_BIT);
+#ifndef NDEBUG
+	data.Label ("Temporary texture array data buffer.");
+#endif
+
+	for (auto level = 0; level < h.numberOfMipmapLevels; level++)
+	{
+		GLsizei width = GetKTXLevelWidth (h, level);
+		GLsizei height = GetKTXLevelHeight (h, level);
+		for (auto layer = 0; layer < layers.size (); layer++)
+		{
+			const std::vector<char> &image = layers[layer][level];
+			void *ptr = data.MapRange (0, image.size (), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			memcpy (ptr, image.data (), image.size ());
+			data.Unmap ();
+			gl::MemoryBarrier (GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+
+			data.Bind (GL_PIXEL_UNPACK_BUFFER);
+			if (h.glType)
+				texture.SubImage3D (level, 0, 0, layer * h.numberOfFaces, width, height, h.numberOfFaces,
+									h.glFormat, h.glType, NULL);
+			else
+				texture.CompressedSubImage3D (level, 0, 0, layer * h.numberOfFaces, width, height,
+											  h.numberOfFaces, h.glInternalFormat, image.size (), NULL);
+			gl::Buffer::Unbind (GL_PIXEL_UNPACK_BUFFER);
+		}
+	}
+
+	return texture;
+}
+
+} /* namespace glutil */
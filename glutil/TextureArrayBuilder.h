@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef GLUTIL_TEXTUREARRAYBUILDER_H
+#define GLUTIL_TEXTUREARRAYBUILDER_H
+
+#include <oglp/oglp.h>
+#include <istream>
+#include <vector>
+#include "detail/KTX.h"
+
+namespace glutil {
+
+/*
+ * Assembles several KTX textures of identical format and size into a single
+ * GL_TEXTURE_2D_ARRAY (or GL_TEXTURE_CUBE_MAP_ARRAY for cube maps).
+ * The image data is kept in memory until Build is called.
+ */
+class TextureArrayBuilder
+{
+public:
+	TextureArrayBuilder (void);
+	TextureArrayBuilder (const TextureArrayBuilder&) = delete;
+	~TextureArrayBuilder (void);
+
+	TextureArrayBuilder &operator= (const TextureArrayBuilder&) = delete;
+
+	/* reads a KTX texture and returns the array layer it will occupy */
+	GLint Add (std::istream &stream);
+	gl::Texture Build (void) const;
+
+	GLint GetLayerCount (void) const {
+		return layers.size ();
+	}
+private:
+	detail::ktx_header_t header;
+	detail::ktx_keyvalues_t keyvalues;
+	/* image data per layer and mipmap level */
+	std::vector<std::vector<std::vector<char>>> layers;
+};
+
+} /* namespace glutil */
+
+#endif /* !defined GLUTIL_TEXTUREARRAYBUILDER_H */
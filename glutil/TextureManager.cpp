@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "TextureManager.h"
+#include "LoadTexture.h"
+#include "detail/KTX.h"
+#include <fstream>
+#include <stdexcept>
+
+namespace glutil {
+
+using namespace detail;
+
+TextureManager::Entry::Entry (void) : layer (-1), region (0, 0, 1, 1)
+{
+}
+
+TextureManager::Atlas::Atlas (GLenum _internalformat, GLsizei size, GLsizei layers)
+	: texture (std::make_shared<gl::Texture> (GL_TEXTURE_2D_ARRAY)), internalformat (_internalformat)
+{
+	texture->Storage3D (1, internalformat, size, size, layers);
+	texture->Parameter (GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	texture->Parameter (GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	texture->Parameter (GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	packers.reserve (layers);
+	for (auto i = 0; i < layers; i++)
+		packers.emplace_back (size, size, 1);
+#ifndef NDEBUG
+	texture->Label ("Texture manager atlas.");
+#endif
+}
+
+TextureManager::TextureManager (unsigned long _budget, GLsizei _atlassize, GLsizei _atlaslayers,
+								GLsizei _maxpackedsize)
+	: budget (_budget), usage (0), atlassize (_atlassize), atlaslayers (_atlaslayers),
+	  maxpackedsize (_maxpackedsize)
+{
+}
+
+TextureManager::~TextureManager (void)
+{
+}
+
+std::shared_ptr<const TextureManager::Entry> TextureManager::Load (const std::string &filename)
+{
+	auto it = entries.find (filename);
+	if (it != entries.end ())
+	{
+		lru.splice (lru.begin (), lru, it->second);
+		return it->second->entry;
+	}
+	std::ifstream stream (filename.c_str (), std::ios_base::in | std::ios_base::binary);
+	if (!stream.is_open ())
+		throw std::runtime_error ("Unable to load texture: cannot open " + filename + ".");
+	return Load (filename, stream);
+}
+
+std::shared_ptr<const TextureManager::Entry> TextureManager::Load (const std::string &name, std::istream &stream)
+{
+	auto it = entries.find (name);
+	if (it != entries.end ())
+	{
+		lru.splice (lru.begin (), lru, it->second);
+		return it->second->entry;
+	}
+
+	std::streampos start = stream.tellg ();
+	std::shared_ptr<Entry> entry = Pack (stream);
+	unsigned long size = 0;
+	if (!entry)
+	{
+		stream.clear ();
+		if (!stream.seekg (start))
+			throw std::runtime_error ("Unable to load texture: cannot seek texture data");
+		entry = std::shared_ptr<Entry> (new Entry);
+		entry->texture = std::make_shared<gl::Texture> (LoadTexture (stream));
+		std::streampos end = stream.tellg ();
+		if (start != std::streampos (-1) && end != std::streampos (-1))
+			size = end - start;
+	}
+
+	lru.push_front ({ name, entry, size });
+	entries[name] = lru.begin ();
+	usage += size;
+	Evict ();
+	return entry;
+}
+
+void TextureManager::SetBudget (unsigned long _budget)
+{
+	budget = _budget;
+	Evict ();
+}
+
+void TextureManager::Evict (void)
+{
+	if (budget == 0)
+		return;
+	for (auto it = lru.end (); it != lru.begin () && usage > budget;)
+	{
+		--it;
+		if (it->entry->IsPacked () || it->entry.use_count () > 1)
+			continue;
+		usage -= it->size;
+		entries.erase (it->name);
+		it = lru.erase (it);
+	}
+}
+
+std::shared_ptr<TextureManager::Entry> TextureManager::Pack (std::istream &stream)
+{
+	ktx_header_t header;
+	ReadKTXHeader (stream, header);
+	if (!header.glType || header.numberOfMipmapLevels > 1 || header.numberOfFaces != 1
+		|| header.pixelDepth != 0 || header.numberOfArrayElements != 0 || header.pixelHeight == 0
+		|| header.pixelWidth > maxpackedsize || header.pixelHeight > maxpackedsize)
+		return nullptr;
+	{
+		ktx_keyvalues_t keyvalues;
+		ReadKTXKeyValueData (stream, header, keyvalues);
+		if (IsKTXSupercompressed (keyvalues))
+			return nullptr;
+	}
+
+	uint32_t size;
+	if (!stream.read (reinterpret_cast<char*> (&size), sizeof (uint32_t)))
+		throw std::runtime_error ("Unable to load texture: cannot read block size");
+
+	Atlas *atlas = nullptr;
+	int x, y, layer = 0;
+	for (auto &candidate : atlases)
+	{
+		if (candidate->internalformat != header.glInternalFormat)
+			continue;
+		for (layer = 0; layer < candidate->packers.size (); layer++)
+		{
+			if (candidate->packers[layer].Insert (header.pixelWidth, header.pixelHeight, x, y))
+			{
+				atlas = candidate.get ();
+				break;
+			}
+		}
+		if (atlas)
+			break;
+	}
+	if (!atlas)
+	{
+		atlases.emplace_back (new Atlas (header.glInternalFormat, atlassize, atlaslayers));
+		atlas = atlases.back ().get ();
+		layer = 0;
+		if (!atlas->packers[0].Insert (header.pixelWidth, header.pixelHeight, x, y))
+			throw std::runtime_error ("Unable to pack texture into atlas.");
+		/* estimate the atlas size from the bytes per pixel of the first texture */
+		usage += (unsigned long) atlaslayers * atlassize * atlassize * size / (header.pixelWidth * header.pixelHeight);
+	}
+
+	std::shared_ptr<Entry> entry (new Entry);
+	entry->texture = atlas->texture;
+	entry->layer = layer;
+	entry->region = glm::vec4 (float (x) / atlassize, float (y) / atlassize,
+							   float (header.pixelWidth) / atlassize, float (header.pixelHeight) / atlassize);
+
+	gl::Buffer data;
+	data.Storage (size, NULL, GL_MAP_WRITE_BIT | GL_CLIENT_STORAGE_BIT);
+#ifndef NDEBUG
+	data.Label ("Temporary texture data buffer.");
+#endif
+	ReadKTXImage (stream, data, size);
+	data.Bind (GL_PIXEL_UNPACK_BUFFER);
+	atlas->texture->SubImage3D (0, x, y, layer, header.pixelWidth, header.pixelHeight, 1,
+								header.glFormat, header.glType, NULL);
+	gl::Buffer::Unbind (GL_PIXEL_UNPACK_BUFFER);
+
+	/* repeat the edge texels into the border: columns first, then rows including the corners */
+	const GLuint name = atlas->texture->get ();
+	const GLsizei w = header.pixelWidth, h = header.pixelHeight;
+	gl::CopyImageSubData (name, GL_TEXTURE_2D_ARRAY, 0, x, y, layer,
+						  name, GL_TEXTURE_2D_ARRAY, 0, x - 1, y, layer, 1, h, 1);
+	gl::CopyImageSubData (name, GL_TEXTURE_2D_ARRAY, 0, x + w - 1, y, layer,
+						  name, GL_TEXTURE_2D_ARRAY, 0, x + w, y, layer, 1, h, 1);
+	gl::CopyImageSubData (name, GL_TEXTURE_2D_ARRAY, 0, x - 1, y, layer,
+						  name, GL_TEXTURE_2D_ARRAY, 0, x - 1, y - 1, layer, w + 2, 1, 1);
+	gl::CopyImageSubData (name, GL_TEXTURE_2D_ARRAY, 0, x - 1, y + h - 1, layer,
+						  name, GL_TEXTURE_2D_ARRAY, 0, x - 1, y + h, layer, w + 2, 1, 1);
+	return entry;
+}
+
+} /* namespace glutil */
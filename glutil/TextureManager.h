@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef GLUTIL_TEXTUREMANAGER_H
+#define GLUTIL_TEXTUREMANAGER_H
+
+#include <oglp/oglp.h>
+#include <glm/glm.hpp>
+#include <istream>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "detail/SkylinePacker.h"
+
+namespace glutil {
+
+/*
+ * Caches textures by name. Small single-level uncompressed 2D textures are packed
+ * into shared GL_TEXTURE_2D_ARRAY atlases with a one texel border of repeated edge
+ * texels, so that linear filtering does not pick up neighbouring textures; everything
+ * else is loaded with LoadTexture.
+ * Standalone textures that are no longer referenced outside the manager are evicted
+ * in least recently used order once the memory budget is exceeded.
+ */
+class TextureManager
+{
+public:
+	class Entry
+	{
+	public:
+		const gl::Texture &GetTexture (void) const {
+			return *texture;
+		}
+		/* array layer in the atlas or -1 for standalone textures */
+		const GLint &GetLayer (void) const {
+			return layer;
+		}
+		/* offset (xy) and scale (zw) of the normalized texture coordinates */
+		const glm::vec4 &GetRegion (void) const {
+			return region;
+		}
+		bool IsPacked (void) const {
+			return layer >= 0;
+		}
+	private:
+		Entry (void);
+		/* shared with the atlas, so that entries stay valid after the manager is destroyed */
+		std::shared_ptr<const gl::Texture> texture;
+		GLint layer;
+		glm::vec4 region;
+		friend class TextureManager;
+	};
+
+	TextureManager (unsigned long budget = 0, GLsizei atlassize = 1024, GLsizei atlaslayers = 8,
+					GLsizei maxpackedsize = 128);
+	TextureManager (const TextureManager&) = delete;
+	~TextureManager (void);
+
+	TextureManager &operator= (const TextureManager&) = delete;
+
+	std::shared_ptr<const Entry> Load (const std::string &filename);
+	/* the stream has to be seekable */
+	std::shared_ptr<const Entry> Load (const std::string &name, std::istream &stream);
+
+	void SetBudget (unsigned long budget);
+	const unsigned long &GetBudget (void) const {
+		return budget;
+	}
+	const unsigned long &GetUsage (void) const {
+		return usage;
+	}
+	void Evict (void);
+private:
+	typedef struct Atlas {
+		Atlas (GLenum internalformat, GLsizei size, GLsizei layers);
+		std::shared_ptr<gl::Texture> texture;
+		GLenum internalformat;
+		std::vector<detail::SkylinePacker> packers;
+	} Atlas;
+	typedef struct Cached {
+		std::string name;
+		std::shared_ptr<Entry> entry;
+		unsigned long size;
+	} Cached;
+	std::shared_ptr<Entry> Pack (std::istream &stream);
+	std::list<Cached> lru;
+	std::unordered_map<std::string, std::list<Cached>::iterator> entries;
+	std::vector<std::unique_ptr<Atlas>> atlases;
+	unsigned long budget;
+	unsigned long usage;
+	GLsizei atlassize;
+	GLsizei atlaslayers;
+	GLsizei maxpackedsize;
+};
+
+} /* namespace glutil */
+
+#endif /* !defined GLUTIL_TEXTUREMANAGER_H */
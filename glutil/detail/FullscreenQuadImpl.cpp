@@ -22,36 +22,47 @@
  */
 
 #include "FullscreenQuadImpl.h"
+#include "../ContextRegistry.h"
 #include "../LoadProgram.h"
+#include "../StateCache.h"
+#include "shaders/fsquad.h"
 #include <limits>
 
-GLUTIL_IMPORT_SHADER(shader, fsquad)
-
 namespace glutil {
 namespace detail {
 
-FullscreenQuadImpl::FullscreenQuadImpl(void)
+FullscreenQuadImpl::FullscreenQuadImpl(FullscreenQuad::Mode _mode, ContextRegistry *_registry)
+	: mode (_mode), registry (_registry), references (0)
 {
 	program.Parameter (GL_PROGRAM_SEPARABLE, GL_TRUE);
 
+	if (mode == FullscreenQuad::TRIANGLE)
+	{
+		LoadProgram (program, "FSQUAD_TRIANGLE", "#define FSQUAD_TRIANGLE", {
+			{ "FSQUAD_VERTEX", GL_VERTEX_SHADER, shader::fsquad }
+		});
+		return;
+	}
+
     LoadProgram (program, "FSQUAD", "", {
 		{ "FSQUAD_VERTEX", GL_VERTEX_SHADER, shader::fsquad }
 	});
 
+	buffer.reset (new gl::Buffer);
 	const GLshort data[] = { std::numeric_limits<short>::min (), std::numeric_limits<short>::min (),
 							 std::numeric_limits<short>::max (), std::numeric_limits<short>::min (),
 							 std::numeric_limits<short>::min (), std::numeric_limits<short>::max (),
 							 std::numeric_limits<short>::max (), std::numeric_limits<short>::max () };
-	buffer.Data (sizeof (data), data, GL_STATIC_DRAW);
+	buffer->Data (sizeof (data), data, GL_STATIC_DRAW);
 
 	vao.AttribFormat (0, 2, GL_SHORT, GL_TRUE, 0);
 	vao.AttribBinding (0, 0);
 	vao.EnableAttrib (0);
 
-	vao.VertexBuffer (0, buffer, 0, 2 * sizeof (GLshort));
+	vao.VertexBuffer (0, *buffer, 0, 2 * sizeof (GLshort));
 
 #ifndef NDEBUG
-	buffer.Label ("FullscreenQuad vertex buffer.");
+	buffer->Label ("FullscreenQuad vertex buffer.");
 #endif
 }
 
@@ -59,12 +70,40 @@ FullscreenQuadImpl::~FullscreenQuadImpl(void)
 {
 }
 
+void FullscreenQuadImpl::Release (FullscreenQuadImpl *fsquad)
+{
+    if (--fsquad->references)
+        return;
+    if (fsquad->registry)
+        fsquad->registry->fsquads[fsquad->mode] = nullptr;
+    delete fsquad;
+}
+
 void FullscreenQuadImpl::Render (void) const
 {
-    gl::Disable (GL_DEPTH_TEST);
+    GLboolean depthtest = gl::IsEnabled (GL_DEPTH_TEST);
+    if (depthtest)
+        gl::Disable (GL_DEPTH_TEST);
     vao.Bind ();
-    gl::DrawArrays (GL_TRIANGLE_STRIP, 0, 4);
-    gl::Enable (GL_DEPTH_TEST);
+    if (mode == FullscreenQuad::TRIANGLE)
+        gl::DrawArrays (GL_TRIANGLES, 0, 3);
+    else
+        gl::DrawArrays (GL_TRIANGLE_STRIP, 0, 4);
+    if (depthtest)
+        gl::Enable (GL_DEPTH_TEST);
+}
+
+void FullscreenQuadImpl::Render (StateCache &state) const
+{
+    /* the caller guarantees that the cache is up to date */
+    bool depthtest = state.IsEnabled (GL_DEPTH_TEST);
+    state.Disable (GL_DEPTH_TEST);
+    state.BindVertexArray (vao.get ());
+    if (mode == FullscreenQuad::TRIANGLE)
+        gl::DrawArrays (GL_TRIANGLES, 0, 3);
+    else
+        gl::DrawArrays (GL_TRIANGLE_STRIP, 0, 4);
+    state.SetEnabled (GL_DEPTH_TEST, depthtest);
 }
 
 } /* namespace detail */
@@ -26,34 +26,41 @@
 
 #include <oglp/oglp.h>
 #include <memory>
-#include <mutex>
+#include "../FullscreenQuad.h"
 
 namespace glutil {
+
+class ContextRegistry;
+
 namespace detail {
 
 class FullscreenQuadImpl
 {
 public:
-    static std::shared_ptr<FullscreenQuadImpl> GetInstance (void) {
-        static std::weak_ptr<FullscreenQuadImpl> instance;
-        static std::mutex mutex;
-        const std::lock_guard<std::mutex> lock (mutex);
-        std::shared_ptr<FullscreenQuadImpl> result = instance.lock ();
-        if (!result) instance = (result = std::make_shared<FullscreenQuadImpl> ());
-        return result;
-    }
-    FullscreenQuadImpl(void);
+    FullscreenQuadImpl(FullscreenQuad::Mode mode, ContextRegistry *registry);
 	FullscreenQuadImpl(const FullscreenQuadImpl &) = delete;
 	~FullscreenQuadImpl(void);
 	FullscreenQuadImpl &operator= (const FullscreenQuadImpl &) = delete;
 	void Render (void) const;
+	void Render (StateCache &state) const;
     const gl::Program &GetVertexProgram (void) const {
 		return program;
 	}
+	void AddReference (void) {
+		references++;
+	}
+	/* drops a reference and destroys the quad with the last one */
+	static void Release (FullscreenQuadImpl *fsquad);
 private:
  	gl::Program program;
 	gl::VertexArray vao;
-	gl::Buffer buffer;
+	/* only used by FullscreenQuad::STRIP */
+	std::unique_ptr<gl::Buffer> buffer;
+	FullscreenQuad::Mode mode;
+	/* cleared if the registry is destroyed first */
+	ContextRegistry *registry;
+	size_t references;
+	friend class glutil::ContextRegistry;
 };
 
 } /* namespace detail */
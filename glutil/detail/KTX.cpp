@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "KTX.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace glutil {
+namespace detail {
+
+namespace {
+
+const uint8_t ktx_identifier[12] = {
+	0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+};
+
+GLint StringToWrapMode (const std::string &value)
+{
+	if (!value.compare ("CLAMP_TO_EDGE"))
+		return GL_CLAMP_TO_EDGE;
+	else if (!value.compare ("CLAMP_TO_BORDER"))
+		return GL_CLAMP_TO_BORDER;
+	else if (!value.compare ("MIRRORED_REPEAT"))
+		return GL_MIRRORED_REPEAT;
+	else if (!value.compare ("REPEAT"))
+		return GL_REPEAT;
+	else if (!value.compare ("MIRROR_CLAMP_TO_EDGE"))
+		return GL_MIRROR_CLAMP_TO_EDGE;
+	else throw std::runtime_error ("Unable to load texture: invalid texture wrap mode.");
+}
+
+} /* anonymous namespace */
+
+void ReadKTXHeader (std::istream &stream, ktx_header_t &header)
+{
+	if (!stream.read (reinterpret_cast<char*> (&header), sizeof (ktx_header_t)))
+		throw std::runtime_error ("Unable to load texture: cannot read KTX header.");
+	if (memcmp (header.identifier, ktx_identifier, 12) || header.endianness != 0x04030201)
+		throw std::runtime_error ("Unable to load texture: invalid file format.");
+}
+
+void ReadKTXKeyValueData (std::istream &stream, const ktx_header_t &header, ktx_keyvalues_t &keyvalues)
+{
+	uint32_t read = 0;
+	while (read < header.bytesOfKeyValueData)
+	{
+		uint32_t size = 0;
+		std::vector<char> data;
+		if (!stream.read (reinterpret_cast<char*> (&size), sizeof (uint32_t)))
+			throw std::runtime_error ("Unable to load texture: cannot read key value data size.");
+		data.resize (size + 1);
+		if (!stream.read (data.data (), size))
+			throw std::runtime_error ("Unable to load texture: cannot read key value data.");
+		data[size] = 0;
+		std::string key (data.data ());
+		std::string value;
+		if (key.size () < size)
+			value = std::string (&data[key.size () + 1]);
+		keyvalues.emplace_back (key, value);
+
+		size_t skip = 3 - ((size + 3) % 4);
+		if (skip) stream.ignore (skip);
+		read += sizeof (uint32_t) + size + skip;
+	}
+}
+
+GLenum GetKTXTarget (const ktx_header_t &header)
+{
+	if (header.pixelHeight == 0 || (header.numberOfFaces != 1 && header.numberOfFaces != 6))
+		throw std::runtime_error ("Unable to load texture: format currently unsupported");
+	if (header.pixelDepth != 0)
+	{
+		if (header.numberOfArrayElements != 0 || header.numberOfFaces != 1)
+			throw std::runtime_error ("Unable to load texture: format currently unsupported");
+		return GL_TEXTURE_3D;
+	}
+	if (header.numberOfArrayElements != 0)
+		return (header.numberOfFaces > 1) ? GL_TEXTURE_CUBE_MAP_ARRAY : GL_TEXTURE_2D_ARRAY;
+	return (header.numberOfFaces > 1) ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+}
+
+void AllocateKTXStorage (gl::Texture &texture, const ktx_header_t &header, GLsizei levels, GLint first)
+{
+	GLsizei width = GetKTXLevelWidth (header, first);
+	GLsizei height = GetKTXLevelHeight (header, first);
+	if (header.pixelDepth != 0 || header.numberOfArrayElements != 0)
+		texture.Storage3D (levels, header.glInternalFormat, width, height, GetKTXLevelDepth (header, first));
+	else
+		texture.Storage2D (levels, header.glInternalFormat, width, height);
+}
+
+void SetKTXParameters (gl::Texture &texture, const ktx_header_t &header, const ktx_keyvalues_t &keyvalues)
+{
+	if (header.numberOfFaces > 1) {
+		texture.Parameter (GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		texture.Parameter (GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		texture.Parameter (GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	for (auto &keyvalue : keyvalues)
+	{
+		if (keyvalue.second.empty ())
+			continue;
+		if (!keyvalue.first.compare ("WRAP_S"))
+			texture.Parameter (GL_TEXTURE_WRAP_S, StringToWrapMode (keyvalue.second));
+		else if (!keyvalue.first.compare ("WRAP_T"))
+			texture.Parameter (GL_TEXTURE_WRAP_T, StringToWrapMode (keyvalue.second));
+		else if (!keyvalue.first.compare ("WRAP_R"))
+			texture.Parameter (GL_TEXTURE_WRAP_R, StringToWrapMode (keyvalue.second));
+	}
+}
+
+bool IsKTXSupercompressed (const ktx_keyvalues_t &keyvalues)
+{
+	for (auto &keyvalue : keyvalues)
+	{
+		if (!keyvalue.first.compare ("GLUTIL_SUPERCOMPRESSION"))
+		{
+			if (!keyvalue.second.compare ("LZ4"))
+				return true;
+			throw std::runtime_error ("Unable to load texture: unsupported supercompression scheme.");
+		}
+	}
+	return false;
+}
+
+void ReadKTXImage (std::istream &stream, gl::Buffer &buffer, uint32_t size)
+{
+	void *ptr = buffer.MapRange (0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	stream.read (reinterpret_cast<char*> (ptr), size);
+	buffer.Unmap ();
+	if (!stream) throw std::runtime_error ("Unable to load texture: cannot read texture data");
+	gl::MemoryBarrier (GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+}
+
+void UploadKTXImage (gl::Texture &texture, const ktx_header_t &header, GLint texlevel, GLint level,
+					 GLint face, uint32_t size, const gl::Buffer &buffer, GLintptr offset)
+{
+	GLsizei width = GetKTXLevelWidth (header, level);
+	GLsizei height = GetKTXLevelHeight (header, level);
+	GLint zoffset = 0;
+	GLsizei depth = 1;
+	bool layered = true;
+	if (header.pixelDepth != 0 || header.numberOfArrayElements != 0)
+		depth = GetKTXLevelDepth (header, level);
+	else if (header.numberOfFaces > 1)
+		zoffset = face;
+	else
+		layered = false;
+
+	buffer.Bind (GL_PIXEL_UNPACK_BUFFER);
+	if (header.glType)
+	{
+		if (layered) {
+			texture.SubImage3D (texlevel, 0, 0, zoffset, width, height, depth, header.glFormat, header.glType,
+								reinterpret_cast<const void*> (offset));
+		} else {
+			texture.SubImage2D (texlevel, 0, 0, width, height, header.glFormat, header.glType,
+								reinterpret_cast<const void*> (offset));
+		}
+	}
+	else
+	{
+		if (layered) {
+			texture.CompressedSubImage3D (texlevel, 0, 0, zoffset, width, height, depth, header.glInternalFormat,
+										  size, reinterpret_cast<const void*> (offset));
+		} else {
+			texture.CompressedSubImage2D (texlevel, 0, 0, width, height, header.glInternalFormat, size,
+										  reinterpret_cast<const void*> (offset));
+		}
+	}
+	gl::Buffer::Unbind (GL_PIXEL_UNPACK_BUFFER);
+}
+
+} /* namespace detail */
+} /* namespace glutil */
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef GLUTIL_DETAIL_KTX_H
+#define GLUTIL_DETAIL_KTX_H
+
+#include <oglp/oglp.h>
+#include <istream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdint.h>
+
+namespace glutil {
+namespace detail {
+
+typedef struct {
+	uint8_t identifier[12];
+	uint32_t endianness;
+	uint32_t glType;
+	uint32_t glTypeSize;
+	uint32_t glFormat;
+	uint32_t glInternalFormat;
+	uint32_t glBaseInternalFormat;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t numberOfArrayElements;
+	uint32_t numberOfFaces;
+	uint32_t numberOfMipmapLevels;
+	uint32_t bytesOfKeyValueData;
+} ktx_header_t;
+
+typedef std::vector<std::pair<std::string, std::string>> ktx_keyvalues_t;
+
+void ReadKTXHeader (std::istream &stream, ktx_header_t &header);
+void ReadKTXKeyValueData (std::istream &stream, const ktx_header_t &header, ktx_keyvalues_t &keyvalues);
+
+GLenum GetKTXTarget (const ktx_header_t &header);
+void SetKTXParameters (gl::Texture &texture, const ktx_header_t &header, const ktx_keyvalues_t &keyvalues);
+/* allocates storage for the given number of levels starting at file level first */
+void AllocateKTXStorage (gl::Texture &texture, const ktx_header_t &header, GLsizei levels, GLint first = 0);
+
+/*
+ * Files with the key GLUTIL_SUPERCOMPRESSION set to LZ4 store every image as its
+ * uncompressed imageSize followed by a 32-bit compressed size and an LZ4 block
+ * padded to four bytes instead of the raw image data.
+ */
+bool IsKTXSupercompressed (const ktx_keyvalues_t &keyvalues);
+
+/* reads one image of the given size into the staging buffer */
+void ReadKTXImage (std::istream &stream, gl::Buffer &buffer, uint32_t size);
+/* uploads one image from the staging buffer into the given level/face of the texture */
+void UploadKTXImage (gl::Texture &texture, const ktx_header_t &header, GLint texlevel, GLint level,
+					 GLint face, uint32_t size, const gl::Buffer &buffer, GLintptr offset = 0);
+
+/* number of separately sized images per mipmap level (only non-array cube maps store one per face) */
+inline uint32_t GetKTXImageCount (const ktx_header_t &header) {
+	return (header.numberOfArrayElements == 0) ? header.numberOfFaces : 1;
+}
+
+inline GLsizei GetKTXLevelWidth (const ktx_header_t &header, GLint level) {
+	return std::max<GLsizei> (1, header.pixelWidth >> level);
+}
+
+inline GLsizei GetKTXLevelHeight (const ktx_header_t &header, GLint level) {
+	return std::max<GLsizei> (1, header.pixelHeight >> level);
+}
+
+/* depth of a level in 3D textures, number of layer-faces otherwise */
+inline GLsizei GetKTXLevelDepth (const ktx_header_t &header, GLint level) {
+	if (header.pixelDepth != 0)
+		return std::max<GLsizei> (1, header.pixelDepth >> level);
+	return std::max<uint32_t> (1, header.numberOfArrayElements) * header.numberOfFaces;
+}
+
+/* number of levels of a full mipmap chain for the base level dimensions */
+inline GLsizei GetKTXMipmapCount (const ktx_header_t &header) {
+	GLsizei levels = 1;
+	for (uint32_t size = std::max (std::max (header.pixelWidth, header.pixelHeight), header.pixelDepth);
+		 size > 1; size >>= 1)
+		levels++;
+	return levels;
+}
+
+} /* namespace detail */
+} /* namespace glutil */
+
+#endif /* !defined GLUTIL_DETAIL_KTX_H */
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "SkylinePacker.h"
+#include <limits>
+
+namespace glutil {
+namespace detail {
+
+SkylinePacker::SkylinePacker (int _width, int _height, int _padding)
+	: width (_width), height (_height), padding (_padding)
+{
+	skyline.push_back ({ 0, 0, width });
+}
+
+SkylinePacker::~SkylinePacker (void)
+{
+}
+
+int SkylinePacker::Fit (size_t index, int w, int h) const
+{
+	int x = skyline[index].x;
+	if (x + w > width)
+		return -1;
+	int y = skyline[index].y;
+	for (int remaining = w; remaining > 0; index++)
+	{
+		if (skyline[index].y > y)
+			y = skyline[index].y;
+		if (y + h > height)
+			return -1;
+		remaining -= skyline[index].width;
+	}
+	return y;
+}
+
+bool SkylinePacker::Insert (int w, int h, int &x, int &y)
+{
+	w += 2 * padding;
+	h += 2 * padding;
+	size_t best = skyline.size ();
+	int besty = std::numeric_limits<int>::max ();
+	int bestwidth = std::numeric_limits<int>::max ();
+	for (size_t i = 0; i < skyline.size (); i++)
+	{
+		int fit = Fit (i, w, h);
+		if (fit < 0)
+			continue;
+		if (fit < besty || (fit == besty && skyline[i].width < bestwidth))
+		{
+			best = i;
+			besty = fit;
+			bestwidth = skyline[i].width;
+		}
+	}
+	if (best == skyline.size ())
+		return false;
+
+	x = skyline[best].x;
+	y = besty;
+	skyline.insert (skyline.begin () + best, { x, y + h, w });
+	x += padding;
+	y += padding;
+
+	for (size_t i = best + 1; i < skyline.size ();)
+	{
+		int shrink = skyline[i - 1].x + skyline[i - 1].width - skyline[i].x;
+		if (shrink <= 0)
+			break;
+		if (shrink < skyline[i].width)
+		{
+			skyline[i].x += shrink;
+			skyline[i].width -= shrink;
+			break;
+		}
+		skyline.erase (skyline.begin () + i);
+	}
+
+	for (size_t i = 0; i + 1 < skyline.size ();)
+	{
+		if (skyline[i].y == skyline[i + 1].y)
+		{
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase (skyline.begin () + i + 1);
+		}
+		else i++;
+	}
+	return true;
+}
+
+} /* namespace detail */
+} /* namespace glutil */
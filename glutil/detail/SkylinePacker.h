@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef GLUTIL_DETAIL_SKYLINEPACKER_H
+#define GLUTIL_DETAIL_SKYLINEPACKER_H
+
+#include <vector>
+#include <cstddef>
+
+namespace glutil {
+namespace detail {
+
+/*
+ * bottom-left skyline rectangle packer; every rectangle is surrounded by a border
+ * of the given padding, which is reserved but not included in the returned position
+ */
+class SkylinePacker
+{
+public:
+	SkylinePacker (int width, int height, int padding = 0);
+	~SkylinePacker (void);
+
+	bool Insert (int width, int height, int &x, int &y);
+private:
+	int Fit (size_t index, int width, int height) const;
+	typedef struct Node {
+		int x;
+		int y;
+		int width;
+	} Node;
+	std::vector<Node> skyline;
+	int width;
+	int height;
+	int padding;
+};
+
+} /* namespace detail */
+} /* namespace glutil */
+
+#endif /* !defined GLUTIL_DETAIL_SKYLINEPACKER_H */
@@ -27,12 +27,24 @@
 #include "Allocator.h"
 #include "AttribPacker.h"
 #include "CircularBuffer.h"
+#include "ContextRegistry.h"
 #include "FullscreenQuad.h"
+#include "GPUTimer.h"
 #include "LoadProgram.h"
 #include "LoadTexture.h"
+#include "PostProcessGraph.h"
+#include "ProgramBinaryCache.h"
+#include "ProgramPermutations.h"
+#include "ProgramPipelineCache.h"
+#include "ProgramStatistics.h"
 #include "shader.h"
+#include "ShaderReloader.h"
 #include "SimpleAllocator.h"
+#include "StateCache.h"
 #include "StaticBufferManager.h"
+#include "StreamingTexture.h"
+#include "TextureArrayBuilder.h"
+#include "TextureManager.h"
 
 namespace glutil {
 
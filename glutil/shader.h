@@ -28,11 +28,30 @@
 
 namespace glutil {
 
+/* LZ4 covers both the fast and the HC compressor, they share the block format;
+ * LZ4_DICT sources were compressed against a dictionary shared by all shaders
+ * of one glsl2cpp batch */
+typedef enum shadercodec
+{
+    SHADER_CODEC_LZ4 = 0,
+    SHADER_CODEC_RAW = 1,
+    SHADER_CODEC_LZ4_DICT = 2
+} shadercodec_t;
+
 typedef struct shadersource
 {
     const char *version;
+    /* length of the decoded source */
     uint32_t length;
     const uint8_t *data;
+    /* size of data in bytes */
+    uint32_t size;
+    uint32_t codec;
+    /* the dictionary for SHADER_CODEC_LZ4_DICT, itself an embedded source */
+    const struct shadersource *dictionary;
+    /* optional OpenGL SPIR-V module compiled offline from the same source */
+    const uint8_t *spirv;
+    uint32_t spirvsize;
 } shadersource_t;
 
 } /* namespace glutil */
@@ -1,6 +1,8 @@
 #version 430 core
 
+#ifndef FSQUAD_TRIANGLE
 layout (location = 0) in vec2 vPosition;
+#endif
 
 out gl_PerVertex {
     vec4 gl_Position;
@@ -10,6 +12,12 @@ out vec2 fTexcoord;
 
 void main (void)
 {
-	gl_Position = vec4 (vPosition, 0, 1);
-	fTexcoord = 0.5 * vPosition + 0.5;
+#ifdef FSQUAD_TRIANGLE
+	// a single triangle (-1,-1), (3,-1), (-1,3) covering the viewport
+	vec2 position = vec2 ((gl_VertexID & 1) * 4 - 1, (gl_VertexID & 2) * 2 - 1);
+#else
+	vec2 position = vPosition;
+#endif
+	gl_Position = vec4 (position, 0, 1);
+	fTexcoord = 0.5 * position + 0.5;
 }
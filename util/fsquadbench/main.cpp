@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2015 Daniel Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glutil/glutil.h>
+#include <cstdlib>
+#include <iostream>
+
+/* a full-screen pass with enough work per fragment for helper invocations to matter */
+const char *fragmentsource =
+	"in vec2 fTexcoord;\n"
+	"layout (location = 0) out vec4 color;\n"
+	"void main (void)\n"
+	"{\n"
+	"	vec2 p = fTexcoord;\n"
+	"	for (int i = 0; i < 16; i++)\n"
+	"		p = vec2 (sin (p.x * 3.1 + p.y), cos (p.y * 2.7 - p.x));\n"
+	"	color = vec4 (dFdx (p.x), dFdy (p.y), p);\n"
+	"}\n";
+
+void usage (const char *progname)
+{
+	std::cerr << "Usage: " << progname << " [width] [height] [passes]" << std::endl
+						<< "Compares the GPU time of full-screen passes drawn as a triangle"
+						<< std::endl
+						<< "strip and as a single triangle. Runs headless through EGL, e.g. on"
+						<< std::endl
+						<< "a software rasterizer with LIBGL_ALWAYS_SOFTWARE=1." << std::endl;
+}
+
+bool create_context (void)
+{
+	EGLDisplay display = eglGetDisplay (EGL_DEFAULT_DISPLAY);
+	if (display == EGL_NO_DISPLAY || !eglInitialize (display, NULL, NULL))
+		 return false;
+
+	const EGLint configattribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint count = 0;
+	if (!eglChooseConfig (display, configattribs, &config, 1, &count) || count < 1)
+		 return false;
+
+	const EGLint surfaceattribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+	EGLSurface surface = eglCreatePbufferSurface (display, config, surfaceattribs);
+	if (surface == EGL_NO_SURFACE || !eglBindAPI (EGL_OPENGL_API))
+		 return false;
+
+	const EGLint contextattribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext context = eglCreateContext (display, config, EGL_NO_CONTEXT, contextattribs);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent (display, surface, surface, context))
+		 return false;
+
+	oglp::Init (reinterpret_cast<oglp::GetProcAddressCallback> (eglGetProcAddress));
+	return true;
+}
+
+double measure (glutil::FullscreenQuad::Mode mode, const gl::Program &fragment, int passes)
+{
+	glutil::FullscreenQuad fsquad (mode);
+	gl::ProgramPipeline pipeline;
+	pipeline.UseStages (GL_VERTEX_SHADER_BIT, fsquad.GetVertexProgram ());
+	pipeline.UseStages (GL_FRAGMENT_SHADER_BIT, fragment);
+	pipeline.Bind ();
+
+	/* warm up, so that no lazy driver work ends up in the measurement */
+	fsquad.Render ();
+
+	glutil::GPUTimer timer;
+	timer.Begin ();
+	for (int i = 0; i < passes; i++)
+	{
+		fsquad.Render ();
+	}
+	timer.End ();
+	return timer.Wait () / passes;
+}
+
+int main (int argc, char *argv[])
+{
+	if (argc > 4)
+	{
+		usage (argv[0]);
+		return -1;
+	}
+	int width = argc > 1 ? atoi (argv[1]) : 1920;
+	int height = argc > 2 ? atoi (argv[2]) : 1080;
+	int passes = argc > 3 ? atoi (argv[3]) : 100;
+	if (width <= 0 || height <= 0 || passes <= 0)
+	{
+		usage (argv[0]);
+		return -1;
+	}
+
+	if (!create_context ())
+	{
+		std::cerr << "Cannot create an OpenGL 4.5 core context." << std::endl;
+		return -1;
+	}
+
+	try
+	{
+		gl::Texture target (GL_TEXTURE_2D);
+		target.Storage2D (1, GL_RGBA8, width, height);
+		gl::Framebuffer framebuffer;
+		framebuffer.Texture (GL_COLOR_ATTACHMENT0, target, 0);
+		framebuffer.Bind (GL_FRAMEBUFFER);
+		gl::Viewport (0, 0, width, height);
+
+		gl::Program fragment;
+		fragment.Parameter (GL_PROGRAM_SEPARABLE, GL_TRUE);
+		glutil::LoadProgram (fragment, "FSQUADBENCH", "", {
+			{ "FSQUADBENCH_FRAGMENT", GL_FRAGMENT_SHADER, fragmentsource, "430 core" }
+		});
+
+		double strip = measure (glutil::FullscreenQuad::STRIP, fragment, passes);
+		double triangle = measure (glutil::FullscreenQuad::TRIANGLE, fragment, passes);
+
+		std::cout << width << "x" << height << ", " << passes << " passes" << std::endl
+							<< "strip:    " << strip * 1000.0 << " ms per pass" << std::endl
+							<< "triangle: " << triangle * 1000.0 << " ms per pass ("
+							<< 100.0 * (strip - triangle) / strip << "% faster)" << std::endl;
+	}
+	catch (std::exception &e)
+	{
+		std::cerr << e.what () << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
@@ -29,12 +29,41 @@
 #include <lz4.h>
 #include <lz4hc.h>
 #include <stdint.h>
-#include <iomanip>
 #include <sstream>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <iterator>
+#include <algorithm>
 
 std::string inputfilename;
 std::string outputfilename;
+std::string manifestfilename;
+std::string depfilename;
+bool minify = false;
+bool renamelocals = false;
+bool benchmark = false;
+bool dictionary = false;
+bool embedspirv = false;
+bool headeronly = false;
+
+/* codec tags, these have to match glutil::shadercodec_t */
+enum { CODEC_LZ4 = 0, CODEC_RAW = 1, CODEC_LZ4_DICT = 2 };
+/* name of the shared dictionary in batch mode */
+std::string dictionaryname = "glsl2cpp_dictionary";
+/* LZ4 only references the last 64 KiB of its history */
+const size_t max_dictionary_size = 65536;
+int codec = CODEC_LZ4;
+/* LZ4-HC compression level, 0 selects the fast LZ4 compressor */
+int hclevel = 16;
 std::string id;
+std::string stage;
+std::string validator;
 std::vector<std::string> incdirs;
 std::vector<std::string> headers;
 std::vector<std::string> append;
@@ -62,6 +91,8 @@ void add_incdir (const std::string &dir)
 void usage (const char *progname)
 {
 	std::cerr << "Usage: " << progname << " [options] [id] [input] [output]"
+						<< std::endl
+						<< "       " << progname << " [options] -B [manifest] [output]"
 						<< std::endl
 						<< "Packs a GLSL source file into c++ code." << std::endl
 						<< std::endl
@@ -77,7 +108,65 @@ void usage (const char *progname)
 						<< std::endl
 						<< "  -T32  specifies the unsigned 32-bit data type to use"
 						<< std::endl
-						<< "        (this is ignored if -S is used)" << std::endl;
+						<< "        (this is ignored if -S is used)" << std::endl
+						<< "  -B    packs all shaders listed in a manifest into one output file;"
+						<< std::endl
+						<< "        each line lists the qualified id and the input file,"
+						<< std::endl
+						<< "        e.g. \"shader::fsquad fsquad.glsl\"" << std::endl
+						<< "        (requires -S)" << std::endl
+						<< "  -M    writes a make dependency file listing every file read"
+						<< std::endl
+						<< "  -m    minifies the source by collapsing whitespace and dropping"
+						<< std::endl
+						<< "        #line directives, then reports the size reduction" << std::endl
+						<< "  -r    like -m, but also renames parameters and local variables"
+						<< std::endl
+						<< "  -C    selects the codec: raw, lz4 or lz4hc[=level] (default lz4hc=16)"
+						<< std::endl
+						<< "  -b    reports the total size and decode time of every codec"
+						<< std::endl
+						<< "  -D    compresses all shaders of a batch against a shared dictionary"
+						<< std::endl
+						<< "        built from their common lines (requires -B and lz4)" << std::endl
+						<< "  -G    validates every shader with the given glslangValidator"
+						<< std::endl
+						<< "  -E    also embeds OpenGL SPIR-V generated by the validator (requires -G)"
+						<< std::endl
+						<< "  -s    the default shader stage (vert, tesc, tese, geom, frag or comp) for -G;"
+						<< std::endl
+						<< "        by default it is taken from the input file extension,"
+						<< std::endl
+						<< "        e.g. \"blur.frag\" or \"blur.frag.glsl\"" << std::endl
+						<< "  -i    writes a header with inline data and constexpr length, version"
+						<< std::endl
+						<< "        and hash instead of a source file (requires -S)" << std::endl;
+}
+
+bool parse_codec (const std::string &name, int &codec, int &level)
+{
+	if (name == "raw")
+	{
+		codec = CODEC_RAW;
+		return true;
+	}
+	if (name == "lz4")
+	{
+		codec = CODEC_LZ4;
+		level = 0;
+		return true;
+	}
+	if (!name.compare (0, 5, "lz4hc"))
+	{
+		codec = CODEC_LZ4;
+		level = 16;
+		if (name.size () == 5)
+			 return true;
+		char *end;
+		level = strtol (name.c_str () + 6, &end, 10);
+		return name[5] == '=' && *end == 0 && level > 0;
+	}
+	return false;
 }
 
 int parse_args (int argc, char *argv[])
@@ -149,6 +238,128 @@ int parse_args (int argc, char *argv[])
 				}
 				headers.push_back (argv[i]);
 				continue;
+			case 'B':
+				if (argv[i][2] != 0)
+				{
+					std::cerr << "Invalid option: " << argv[i] << std::endl;
+					return -1;
+				}
+				i++;
+				if (i >= argc)
+				{
+					std::cerr << "No manifest specified after -B."
+										<< std::endl;
+					return -1;
+				}
+				manifestfilename = argv[i];
+				continue;
+			case 'M':
+				if (argv[i][2] != 0)
+				{
+					std::cerr << "Invalid option: " << argv[i] << std::endl;
+					return -1;
+				}
+				i++;
+				if (i >= argc)
+				{
+					std::cerr << "No dependency file specified after -M."
+										<< std::endl;
+					return -1;
+				}
+				depfilename = argv[i];
+				continue;
+			case 'C':
+				if (argv[i][2] != 0)
+				{
+					std::cerr << "Invalid option: " << argv[i] << std::endl;
+					return -1;
+				}
+				i++;
+				if (i >= argc)
+				{
+					std::cerr << "No codec specified after -C."
+										<< std::endl;
+					return -1;
+				}
+				if (!parse_codec (argv[i], codec, hclevel))
+				{
+					std::cerr << "Invalid codec: " << argv[i] << std::endl;
+					return -1;
+				}
+				continue;
+			case 'b':
+				if (argv[i][2] != 0)
+				{
+					std::cerr << "Invalid option: " << argv[i] << std::endl;
+					return -1;
+				}
+				benchmark = true;
+				continue;
+			case 'D':
+				if (argv[i][2] != 0)
+				{
+					std::cerr << "Invalid option: " << argv[i] << std::endl;
+					return -1;
+				}
+				dictionary = true;
+				continue;
+			case 'G':
+				if (argv[i][2] != 0)
+				{
+					std::cerr << "Invalid option: " << argv[i] << std::endl;
+					return -1;
+				}
+				i++;
+				if (i >= argc)
+				{
+					std::cerr << "No validator specified after -G."
+										<< std::endl;
+					return -1;
+				}
+				validator = argv[i];
+				continue;
+			case 'i':
+				if (argv[i][2] != 0)
+				{
+					std::cerr << "Invalid option: " << argv[i] << std::endl;
+					return -1;
+				}
+				headeronly = true;
+				continue;
+			case 'E':
+				if (argv[i][2] != 0)
+				{
+					std::cerr << "Invalid option: " << argv[i] << std::endl;
+					return -1;
+				}
+				embedspirv = true;
+				continue;
+			case 's':
+				if (argv[i][2] != 0)
+				{
+					std::cerr << "Invalid option: " << argv[i] << std::endl;
+					return -1;
+				}
+				i++;
+				if (i >= argc)
+				{
+					std::cerr << "No shader stage specified after -s."
+										<< std::endl;
+					return -1;
+				}
+				stage = argv[i];
+				continue;
+			case 'r':
+				renamelocals = true;
+				/* fallthrough */
+			case 'm':
+				if (argv[i][2] != 0)
+				{
+					std::cerr << "Invalid option: " << argv[i] << std::endl;
+					return -1;
+				}
+				minify = true;
+				continue;
 			case 'I':
 				if (argv[i][2] == 0)
 				{
@@ -205,6 +416,17 @@ int parse_args (int argc, char *argv[])
 			}
 		}
 
+		if (!manifestfilename.empty ())
+		{
+			if (parsed++ > 0)
+			{
+				std::cerr << "Too many arguments." << std::endl;
+				return -1;
+			}
+			outputfilename = argv[i];
+			continue;
+		}
+
 		switch (parsed++)
 		{
 		case 0:
@@ -222,7 +444,19 @@ int parse_args (int argc, char *argv[])
 		}
 	}
 
-	if (parsed < 3)
+	if (headeronly && structname == NULL)
+	{
+		std::cerr << "-i requires -S." << std::endl;
+		return -1;
+	}
+
+	if (embedspirv && validator.empty ())
+	{
+		std::cerr << "-E requires -G." << std::endl;
+		return -1;
+	}
+
+	if (parsed < (manifestfilename.empty () ? 3 : 1))
 	{
 		usage (argv[0]);
 		return -1;
@@ -231,9 +465,31 @@ int parse_args (int argc, char *argv[])
 	return 0;
 }
 
-bool read_file (const std::string &filename, std::vector<char> &data,
+/* contents of every file read so far, keyed by the path it was opened with */
+std::map<std::string, std::vector<char> > file_cache;
+/* resolved paths of include file names */
+std::map<std::string, std::string> include_paths;
+/* guards file_cache and include_paths in batch mode */
+std::mutex file_mutex;
+
+const std::vector<char> *read_file (const std::string &filename, std::string &path,
 								bool searchinc)
 {
+	std::lock_guard<std::mutex> lock (file_mutex);
+	if (searchinc)
+	{
+		std::map<std::string, std::string>::iterator resolved = include_paths.find (filename);
+		if (resolved != include_paths.end ())
+		{
+			path = resolved->second;
+			return &file_cache[path];
+		}
+	}
+	path = filename;
+	std::map<std::string, std::vector<char> >::iterator cached = file_cache.find (path);
+	if (cached != file_cache.end ())
+		 return &cached->second;
+
 	std::ifstream in (filename.c_str (), std::ios_base::in);
 	if (!in.is_open ())
 	{
@@ -242,9 +498,14 @@ bool read_file (const std::string &filename, std::vector<char> &data,
 			for (std::vector<std::string>::iterator it = incdirs.begin ();
 					 it != incdirs.end (); it++)
 			{
-				std::string name;
-				name = (*it) + filename;
-				in.open (name.c_str (), std::ios_base::in);
+				path = (*it) + filename;
+				cached = file_cache.find (path);
+				if (cached != file_cache.end ())
+				{
+					include_paths[filename] = path;
+					return &cached->second;
+				}
+				in.open (path.c_str (), std::ios_base::in);
 				if (in.is_open ())
 					 break;
 			}
@@ -252,30 +513,43 @@ bool read_file (const std::string &filename, std::vector<char> &data,
 		if (!in.is_open ())
 		{
 			std::cerr << "Cannot open " << filename << "." << std::endl;
-			return false;
+			return NULL;
 		}
 	}
-	while (in.good ())
+	if (searchinc)
+		 include_paths[filename] = path;
+	std::vector<char> &data = file_cache[path];
+	char buffer[65536];
+	while (in.read (buffer, sizeof (buffer)) || in.gcount () > 0)
 	{
-		char c = in.get ();
-		if (in.good ())
-			 data.push_back (c);
+		data.insert (data.end (), buffer, buffer + in.gcount ());
 	}
 	in.close ();
-	return true;
+	return &data;
 }
 
-unsigned int source_string_number = 0;
+typedef struct parse_state
+{
+	parse_state (void) : source_string_number (0) { }
+	unsigned int source_string_number;
+	/* files that contained #pragma once */
+	std::set<std::string> include_once;
+} parse_state;
 
 bool parse_file (const std::string &filename, std::string &version, std::string &data,
-								 unsigned int my_source_string_number, bool searchinc = false)
+								 parse_state &state, unsigned int my_source_string_number,
+								 bool searchinc = false)
 {
 	bool comment = false;
 	unsigned int commentstart = 0;
 	unsigned int line = 1;
-	std::vector<char> input;
-	if (!read_file (filename, input, searchinc))
+	std::string path;
+	const std::vector<char> *inputptr = read_file (filename, path, searchinc);
+	if (inputptr == NULL)
 		 return false;
+	if (state.include_once.count (path))
+		 return true;
+	const std::vector<char> &input = *inputptr;
 
 	bool newline = true;
 	for (size_t i = 0; i < input.size (); i++)
@@ -297,6 +571,16 @@ bool parse_file (const std::string &filename, std::string &version, std::string
 				data.append (stream.str ());
 				continue;
 			}
+			// check for #pragma once directive
+			else if (newline && i + 12 <= input.size ()
+					&& !strncmp (&input[i], "#pragma once", 12)
+					&& (i + 12 == input.size () || isspace (input[i + 12])))
+			{
+				state.include_once.insert (path);
+				while (i + 1 < input.size () && input[i + 1] != '\n')
+					i++;
+				continue;
+			}
 			// check for #include directive
 			else if (newline && i + 9 < input.size ()
 					&& !strncmp (&input[i], "#include ", 9))
@@ -315,7 +599,8 @@ bool parse_file (const std::string &filename, std::string &version, std::string
 							 || includefile[includefile.length () - 1] == '\"'
 							 || includefile[includefile.length () - 1] == '>')
 					 includefile.erase (includefile.length () - 1);
-				if (!parse_file (includefile, version, data, source_string_number++, true))
+				if (!parse_file (includefile, version, data, state,
+												 state.source_string_number++, true))
 					 return false;
 
 				{
@@ -381,109 +666,969 @@ bool parse_file (const std::string &filename, std::string &version, std::string
 	return true;
 }
 
-int main (int argc, char *argv[])
+typedef struct token
 {
-	if (parse_args (argc, argv))
-		 return -1;
+	enum { WORD, PUNCT, DIRECTIVE } type;
+	std::string text;
+	/* whether whitespace separated this token from the previous one */
+	bool space;
+} token;
 
-	std::ofstream out (outputfilename.c_str (),
-										 std::ios_base::out|std::ios_base::trunc);
-	if (!out.is_open ())
+bool is_word_char (char c)
+{
+	return isalnum (c) || c == '_' || c == '.';
+}
+
+/* whether two characters would form a different token without a space */
+bool chars_merge (char prev, char next)
+{
+	if (is_word_char (prev))
+		 return is_word_char (next);
+	if (!strchr ("+-*/%<>=!&|^", prev))
+		 return false;
+	return next == '=' || next == prev || (prev == '/' && next == '*');
+}
+
+void tokenize (const std::string &source, std::vector<token> &tokens)
+{
+	bool linestart = true;
+	bool space = false;
+	for (size_t i = 0; i < source.size ();)
 	{
-		std::cerr << "Cannot open " << outputfilename << std::endl;
-		return -1;
+		char c = source[i];
+		if (isspace (c))
+		{
+			if (c == '\n')
+				 linestart = true;
+			space = true;
+			i++;
+			continue;
+		}
+		token t;
+		t.space = space;
+		if (c == '#' && linestart)
+		{
+			/* preprocessor directives are kept verbatim up to the end of the line */
+			t.type = token::DIRECTIVE;
+			while (i < source.size () && source[i] != '\n')
+			{
+				if (source[i] == '\\' && i + 1 < source.size () && source[i + 1] == '\n')
+				{
+					t.text.append ("\\\n");
+					i += 2;
+					continue;
+				}
+				t.text.push_back (source[i++]);
+			}
+			while (isspace (t.text[t.text.length () - 1]))
+				 t.text.erase (t.text.length () - 1);
+		}
+		else if (isalpha (c) || c == '_')
+		{
+			t.type = token::WORD;
+			while (i < source.size () && (isalnum (source[i]) || source[i] == '_'))
+				 t.text.push_back (source[i++]);
+		}
+		else if (isdigit (c) || (c == '.' && i + 1 < source.size () && isdigit (source[i + 1])))
+		{
+			t.type = token::WORD;
+			while (i < source.size () && is_word_char (source[i]))
+			{
+				t.text.push_back (source[i++]);
+				if ((source[i - 1] == 'e' || source[i - 1] == 'E') && t.text.compare (0, 2, "0x")
+						&& i < source.size () && (source[i] == '+' || source[i] == '-'))
+					 t.text.push_back (source[i++]);
+			}
+		}
+		else
+		{
+			t.type = token::PUNCT;
+			t.text.push_back (source[i++]);
+		}
+		tokens.push_back (t);
+		linestart = false;
+		space = false;
 	}
+}
 
-	std::string data;
-	std::string version;
+bool is_type_name (const std::string &name, const std::set<std::string> &structs)
+{
+	static const char *types[] = {
+		"void", "bool", "int", "uint", "float", "double",
+		"vec2", "vec3", "vec4", "dvec2", "dvec3", "dvec4",
+		"bvec2", "bvec3", "bvec4", "ivec2", "ivec3", "ivec4",
+		"uvec2", "uvec3", "uvec4", "mat2", "mat3", "mat4",
+		"mat2x2", "mat2x3", "mat2x4", "mat3x2", "mat3x3", "mat3x4",
+		"mat4x2", "mat4x3", "mat4x4", "dmat2", "dmat3", "dmat4",
+		"dmat2x2", "dmat2x3", "dmat2x4", "dmat3x2", "dmat3x3", "dmat3x4",
+		"dmat4x2", "dmat4x3", "dmat4x4"
+	};
+	for (size_t i = 0; i < sizeof (types) / sizeof (types[0]); i++)
+	{
+		if (name == types[i])
+			 return true;
+	}
+	static const char *prefixes[] = {
+		"sampler", "isampler", "usampler", "image", "iimage", "uimage"
+	};
+	for (size_t i = 0; i < sizeof (prefixes) / sizeof (prefixes[0]); i++)
+	{
+		if (!name.compare (0, strlen (prefixes[i]), prefixes[i]))
+			 return true;
+	}
+	return structs.count (name) > 0;
+}
 
-	if (!parse_file (inputfilename, version, data, source_string_number++, false))
-		 return -1;
+bool is_qualifier (const std::string &name)
+{
+	return name == "const" || name == "in" || name == "out" || name == "inout"
+		|| name == "highp" || name == "mediump" || name == "lowp" || name == "precise";
+}
+
+std::string next_local_name (size_t &counter, const std::set<std::string> &used)
+{
+	for (;;)
+	{
+		std::string name;
+		size_t n = counter++;
+		do
+		{
+			name.insert (name.begin (), 'a' + n % 26);
+			n /= 26;
+		} while (n-- > 0);
+		if (!used.count (name) && name != "do" && name != "if" && name != "in"
+				&& name != "for" && name != "int" && name != "out")
+			 return name;
+	}
+}
+
+/* Renames parameters and local variables of function definitions to short
+ * names. Names that occur anywhere outside of function bodies (globals,
+ * struct members, macros, prototypes) are left alone, so shadowing cannot
+ * change the meaning of the program. */
+void rename_locals (std::vector<token> &tokens)
+{
+	std::set<std::string> used, global, structs;
+	/* find the function definitions: [parameter list start, body end] */
+	std::vector<std::pair<size_t, size_t> > functions;
+	int depth = 0, parens = 0;
+	size_t paramstart = 0;
+	for (size_t i = 0; i < tokens.size (); i++)
+	{
+		const std::string &text = tokens[i].text;
+		if (tokens[i].type == token::DIRECTIVE)
+			 continue;
+		if (depth == 0 && text == "struct" && i + 1 < tokens.size ())
+			 structs.insert (tokens[i + 1].text);
+		if (text == "(")
+		{
+			if (depth == 0 && parens++ == 0)
+				 paramstart = i;
+		}
+		else if (text == ")")
+		{
+			if (depth == 0)
+				 parens--;
+		}
+		else if (text == "{")
+		{
+			if (depth++ == 0 && i > 0 && tokens[i - 1].text == ")")
+				 functions.push_back (std::make_pair (paramstart, i));
+		}
+		else if (text == "}")
+		{
+			/* the body of the last definition is still open */
+			if (--depth == 0 && !functions.empty ()
+					&& tokens[functions.back ().second].text == "{")
+				 functions.back ().second = i;
+		}
+	}
+	/* every name outside of function definitions (including macros and
+	 * parameter names of prototypes) counts as global */
+	size_t next = 0;
+	for (size_t i = 0; i < tokens.size (); i++)
+	{
+		const token &t = tokens[i];
+		if (t.type == token::DIRECTIVE)
+		{
+			std::vector<token> words;
+			tokenize (t.text.substr (1), words);
+			for (size_t j = 0; j < words.size (); j++)
+			{
+				used.insert (words[j].text);
+				global.insert (words[j].text);
+			}
+			continue;
+		}
+		used.insert (t.text);
+		while (next < functions.size () && functions[next].second < i)
+			 next++;
+		if (next == functions.size () || i < functions[next].first)
+			 global.insert (t.text);
+	}
+
+	for (size_t f = 0; f < functions.size (); f++)
+	{
+		size_t begin = functions[f].first, end = functions[f].second;
+		if (tokens[end].text != "}")
+			 continue;
+		std::map<std::string, std::string> names;
+		size_t counter = 0;
+		for (size_t i = begin + 1; i + 1 < end; i++)
+		{
+			if (tokens[i].type != token::WORD || !is_type_name (tokens[i].text, structs))
+				 continue;
+			const std::string &prev = tokens[i - 1].text;
+			if (prev != "(" && prev != "," && prev != ";" && prev != "{" && prev != "}"
+					&& !is_qualifier (prev))
+				 continue;
+			/* collect the declarators of "type a, b[2] = ..., c" up to the end of
+			 * the declaration; parameters have one declarator each */
+			bool parameter = prev == "(" || prev == "," || is_qualifier (prev);
+			int nesting = 0;
+			bool expectname = true;
+			for (size_t j = i + 1; j < end; j++)
+			{
+				const std::string &text = tokens[j].text;
+				if (expectname)
+				{
+					if (tokens[j].type != token::WORD || (j + 1 < end && tokens[j + 1].text == "("))
+						 break;
+					if (!global.count (text) && text.compare (0, 3, "gl_") && !names.count (text))
+						 names[text] = next_local_name (counter, used);
+					expectname = false;
+					continue;
+				}
+				if (text == "(" || text == "[")
+					 nesting++;
+				else if (text == ")" || text == "]")
+				{
+					if (nesting-- == 0)
+						 break;
+				}
+				else if (nesting == 0 && (text == ";" || text == "{" || text == "}"))
+					 break;
+				else if (nesting == 0 && text == ",")
+				{
+					if (parameter)
+						 break;
+					expectname = true;
+				}
+			}
+		}
+		for (size_t i = begin; i <= end; i++)
+		{
+			if (tokens[i].type != token::WORD || (i > 0 && tokens[i - 1].text == "."))
+				 continue;
+			std::map<std::string, std::string>::iterator it = names.find (tokens[i].text);
+			if (it != names.end ())
+				 tokens[i].text = it->second;
+		}
+	}
+}
+
+/* Collapses whitespace and drops #line directives; directives stay on lines
+ * of their own and spaces are kept wherever removing them would merge two
+ * tokens. */
+std::string minify_source (const std::string &source, bool renamelocals)
+{
+	std::vector<token> tokens;
+	tokenize (source, tokens);
+	if (renamelocals)
+		 rename_locals (tokens);
+
+	std::string result;
+	result.reserve (source.size ());
+	bool linestart = true;
+	for (size_t i = 0; i < tokens.size (); i++)
+	{
+		const token &t = tokens[i];
+		if (t.type == token::DIRECTIVE)
+		{
+			if (!t.text.compare (0, 5, "#line") && (t.text.size () == 5 || isspace (t.text[5])))
+				 continue;
+			if (!linestart)
+				 result.push_back ('\n');
+			result.append (t.text);
+			result.push_back ('\n');
+			linestart = true;
+			continue;
+		}
+		if (!linestart && t.space)
+		{
+			if (chars_merge (result[result.size () - 1], t.text[0]))
+				 result.push_back (' ');
+		}
+		result.append (t.text);
+		linestart = false;
+	}
+	if (!linestart)
+		 result.push_back ('\n');
+	return result;
+}
+
+void append_hex (std::string &out, const unsigned char *data, int len)
+{
+	static const char hexdigits[] = "0123456789abcdef";
+	/* each byte takes "0xNN, " and each line of eight bytes "    " and a newline */
+	out.reserve (out.size () + len * 6 + (len / 8 + 1) * 5);
+	for (int i = 0; i < len; i++)
+	{
+		if (i % 8 == 0)
+			out.append ("    ");
+		char hex[4] = { '0', 'x', hexdigits[data[i] >> 4], hexdigits[data[i] & 0xF] };
+		out.append (hex, 4);
+		if (i == len - 1)
+			out.push_back ('\n');
+		else if (i % 8 == 7)
+			out.append (",\n");
+		else
+			out.append (", ");
+	}
+}
+
+/* FNV-1a, the same hash ProgramBinaryCache uses */
+uint64_t hash_source (const std::string &source)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < source.size (); i++)
+	{
+		hash ^= static_cast<unsigned char> (source[i]);
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
 
+std::string make_identifier (const std::string &str)
+{
+	std::string result;
+	for (size_t i = 0; i < str.size (); i++)
+	{
+		result.push_back (isalnum (str[i]) ? str[i] : '_');
+	}
+	return result;
+}
+
+typedef struct shader_entry
+{
+	std::vector<std::string> namespaces;
+	std::string id;
+	std::string input;
+	std::string stage;
+	std::string version;
+	size_t length;
 	std::vector<unsigned char> output;
+	std::vector<unsigned char> spirv;
+	int codec;
+	uint64_t hash;
+	/* preprocessed (and minified) source, kept for -b and -D */
+	std::string source;
+	/* sizes before minification */
+	size_t originallength;
+	size_t originalsize;
+} shader_entry;
+
+bool compress_shader (const std::string &data, std::vector<unsigned char> &output,
+											int codec = ::codec, int level = hclevel)
+{
+	if (codec == CODEC_RAW)
+	{
+		output.assign (data.begin (), data.end ());
+		return true;
+	}
 	output.resize (LZ4_compressBound (data.size ()));
+	int len;
+	if (level > 0)
+		 len = LZ4_compress_HC (&data[0], reinterpret_cast<char*> (&output[0]),
+														data.size (), output.size (), level);
+	else
+		 len = LZ4_compress_default (&data[0], reinterpret_cast<char*> (&output[0]),
+																 data.size (), output.size ());
+	if (len <= 0)
+		 return false;
+	output.resize (len);
+	return true;
+}
 
-	int len = LZ4_compressHC2 (&data[0], reinterpret_cast<char*> (&output[0]),
-														data.size (), 16);
+std::string get_stage (const shader_entry &entry)
+{
+	static const char *stages[] = { "vert", "tesc", "tese", "geom", "frag", "comp" };
+	if (!entry.stage.empty ())
+		 return entry.stage;
+	std::string name = entry.input.substr (entry.input.find_last_of ("/\\") + 1);
+	if (name.size () > 5 && !name.compare (name.size () - 5, 5, ".glsl"))
+		 name.erase (name.size () - 5);
+	for (size_t i = 0; i < sizeof (stages) / sizeof (stages[0]); i++)
+	{
+		if (name.size () > 5 && !name.compare (name.size () - 5, 5, std::string (".") + stages[i]))
+			 return stages[i];
+	}
+	return std::string ();
+}
+
+/* Runs glslangValidator on the expanded source, which is written to a
+ * temporary file next to the output; with -E the SPIR-V it generates is
+ * kept in entry.spirv. The file is named after the qualified id, since
+ * entries of a batch are validated concurrently. */
+bool validate_shader (shader_entry &entry, const std::string &data)
+{
+	std::string stage = get_stage (entry);
+	if (stage.empty ())
+	{
+		std::cerr << "Cannot determine the shader stage of " << entry.input << "." << std::endl;
+		return false;
+	}
+	std::string tmpname = outputfilename + ".";
+	for (size_t i = 0; i < entry.namespaces.size (); i++)
+	{
+		tmpname += entry.namespaces[i] + ".";
+	}
+	tmpname += entry.id + "." + stage;
+	std::string spvname = tmpname + ".spv";
+	{
+		std::ofstream tmp (tmpname.c_str (), std::ios_base::out|std::ios_base::trunc);
+		if (!entry.version.empty ())
+			 tmp << "#version " << entry.version << "\n";
+		tmp.write (data.data (), data.size ());
+		if (!tmp)
+		{
+			std::cerr << "Cannot write " << tmpname << std::endl;
+			return false;
+		}
+	}
+	std::string command = "\"" + validator + "\" -S " + stage;
+	if (embedspirv)
+		 command += " -G -o \"" + spvname + "\"";
+	command += " \"" + tmpname + "\"";
+	bool success = system (command.c_str ()) == 0;
+	if (success && embedspirv)
+	{
+		std::ifstream spv (spvname.c_str (), std::ios_base::in|std::ios_base::binary);
+		entry.spirv.assign (std::istreambuf_iterator<char> (spv), std::istreambuf_iterator<char> ());
+		success = !entry.spirv.empty ();
+	}
+	remove (tmpname.c_str ());
+	remove (spvname.c_str ());
+	if (!success)
+		 std::cerr << "Validation of " << entry.input << " failed." << std::endl;
+	return success;
+}
+
+bool process_shader (shader_entry &entry)
+{
+	std::string data;
+	parse_state state;
 
-	out << "/* this file was generated by glsl2cpp" << std::endl
-			<< " * do not attempt to edit it directly */" << std::endl;
+	if (!parse_file (entry.input, entry.version, data, state, state.source_string_number++, false))
+		 return false;
 
-	for (std::vector<std::string>::iterator it = headers.begin ();
-			 it != headers.end (); it++)
+	if (minify)
 	{
-		out << "#include " << *it << std::endl;
+		if (!compress_shader (data, entry.output))
+		{
+			std::cerr << "Cannot compress " << entry.input << "." << std::endl;
+			return false;
+		}
+		entry.originallength = data.size ();
+		entry.originalsize = entry.output.size ();
+		data = minify_source (data, renamelocals);
 	}
-	out << std::endl;
 
-	for (std::vector<std::string>::iterator it = prepend.begin ();
-			 it != prepend.end (); it++)
+	entry.length = data.size ();
+	entry.hash = hash_source (data);
+	entry.codec = codec;
+	if (!compress_shader (data, entry.output))
 	{
-		out << (*it) << std::endl;
+		std::cerr << "Cannot compress " << entry.input << "." << std::endl;
+		return false;
+	}
+	if (!validator.empty () && !validate_shader (entry, data))
+		 return false;
+	if (benchmark || dictionary)
+		 entry.source.swap (data);
+	return true;
+}
+
+/* Header data is defined as static members of a class template, which
+ * gives it a single address across translation units before C++17 inline
+ * variables; the shadersource itself is reached through a reference. */
+void emit_shader_header (std::string &result, const shader_entry &entry)
+{
+	for (size_t i = 0; i < entry.namespaces.size (); i++)
+	{
+		result.append ("namespace " + entry.namespaces[i] + " {\n");
+	}
+	char hash[32];
+	snprintf (hash, sizeof (hash), "0x%016llxULL", static_cast<unsigned long long> (entry.hash));
+	std::string holder = entry.id + "_data";
+	std::string versionstr = entry.version.empty () ? "nullptr" : "\"" + entry.version + "\"";
+	result.append ("constexpr const char *" + entry.id + "_version = " + versionstr + ";\n"
+				   + "constexpr uint32_t " + entry.id + "_length = " + std::to_string (entry.length) + ";\n"
+				   + "constexpr uint64_t " + entry.id + "_hash = " + hash + ";\n"
+				   + "template<typename = void> struct " + holder + " {\n"
+				   + "    static const " + typename8 + " data[];\n");
+	if (!entry.spirv.empty ())
+		 result.append (std::string ("    static const ") + typename8 + " spirv[];\n");
+	result.append ("    static const struct " + std::string (structname) + " source;\n};\n"
+				   + "template<typename T> const " + typename8 + " " + holder + "<T>::data[] = {\n");
+	append_hex (result, &entry.output[0], entry.output.size ());
+	result.append ("};\n");
+	if (!entry.spirv.empty ())
+	{
+		result.append ("template<typename T> const " + std::string (typename8) + " " + holder + "<T>::spirv[] = {\n");
+		append_hex (result, &entry.spirv[0], entry.spirv.size ());
+		result.append ("};\n");
+	}
+	result.append ("template<typename T> const struct " + std::string (structname) + " " + holder + "<T>::source = { "
+				   + entry.id + "_version, " + entry.id + "_length, data, " + std::to_string (entry.output.size ())
+				   + ", " + std::to_string (entry.codec) + ", "
+				   + (entry.codec == CODEC_LZ4_DICT ? "&::" + dictionaryname + "_data<>::source" : "nullptr") + ", "
+				   + (entry.spirv.empty () ? "nullptr, 0" : "spirv, " + std::to_string (entry.spirv.size ())) + " };\n"
+				   + "static const struct " + structname + " &" + entry.id + " = " + holder + "<>::source;\n");
+
+	for (size_t i = entry.namespaces.size (); i > 0; i--)
+	{
+		result.append ("} /* namespace " + entry.namespaces[i - 1] + " */\n");
+	}
+}
+
+void emit_shader (std::string &result, const shader_entry &entry)
+{
+	if (headeronly)
+	{
+		emit_shader_header (result, entry);
+		return;
+	}
+	for (size_t i = 0; i < entry.namespaces.size (); i++)
+	{
+		result.append ("namespace " + entry.namespaces[i] + " {\n");
+	}
+	/* a const definition inside a namespace needs a prior extern declaration to be visible outside */
+	if (structname != NULL && (!manifestfilename.empty () || !entry.namespaces.empty ())
+		&& entry.id != dictionaryname)
+	{
+		result.append ("extern const struct " + std::string (structname) + " " + entry.id + ";\n");
 	}
-	if (!prepend.empty ())
-		 out << std::endl;
 
+	std::string versionstr = entry.version.empty () ? "nullptr" : "\"" + entry.version + "\"";
 	if (structname != NULL)
 	{
-		out << "const struct " << structname << " " << id << " = { ";
-		if (version.empty ()) {
-			out << "nullptr";
-		} else {
-			out << "\"" << version << "\"";
+		result.append ("const struct " + std::string (structname) + " " + entry.id + " = { " + versionstr
+					   + ", " + std::to_string (entry.length) + ", (const " + typename8 + "[]) {\n");
+	}
+	else
+	{
+		result.append ("const char *" + entry.id + "_version = " + versionstr + ";\n"
+					   + typename32 + " " + entry.id + "_length = " + std::to_string (entry.length) + ";\n"
+					   + typename32 + " " + entry.id + "_size = " + std::to_string (entry.output.size ()) + ";\n"
+					   + typename32 + " " + entry.id + "_codec = " + std::to_string (entry.codec) + ";\n"
+					   + "const " + typename8 + " " + entry.id + "_data[] = {\n");
+	}
+	append_hex (result, &entry.output[0], entry.output.size ());
+	if (structname != NULL)
+	{
+		result.append ("}, " + std::to_string (entry.output.size ()) + ", " + std::to_string (entry.codec) + ", "
+					   + (entry.codec == CODEC_LZ4_DICT ? "&::" + dictionaryname : "nullptr") + ", ");
+		if (entry.spirv.empty ())
+		{
+			result.append ("nullptr, 0 ");
+		}
+		else
+		{
+			result.append (std::string ("(const ") + typename8 + "[]) {\n");
+			append_hex (result, &entry.spirv[0], entry.spirv.size ());
+			result.append ("}, " + std::to_string (entry.spirv.size ()) + " ");
+		}
+	}
+	result.append ("};\n");
+	if (structname == NULL && !entry.spirv.empty ())
+	{
+		result.append (typename32 + std::string (" ") + entry.id + "_spirv_size = "
+					   + std::to_string (entry.spirv.size ()) + ";\n"
+					   + "const " + typename8 + " " + entry.id + "_spirv[] = {\n");
+		append_hex (result, &entry.spirv[0], entry.spirv.size ());
+		result.append ("};\n");
+	}
+
+	for (size_t i = entry.namespaces.size (); i > 0; i--)
+	{
+		result.append ("} /* namespace " + entry.namespaces[i - 1] + " */\n");
+	}
+}
+
+/* splits a qualified id like shader::fsquad into namespaces and the identifier */
+void set_qualified_id (shader_entry &entry, std::string names)
+{
+	size_t pos;
+	while ((pos = names.find ("::")) != std::string::npos)
+	{
+		entry.namespaces.push_back (names.substr (0, pos));
+		names.erase (0, pos + 2);
+	}
+	entry.id = names;
+}
+
+bool read_manifest (const std::string &filename, std::vector<shader_entry> &entries)
+{
+	std::ifstream in (filename.c_str (), std::ios_base::in);
+	if (!in.is_open ())
+	{
+		std::cerr << "Cannot open " << filename << "." << std::endl;
+		return false;
+	}
+	std::string line;
+	while (std::getline (in, line))
+	{
+		std::istringstream stream (line);
+		std::string names;
+		shader_entry entry;
+		if (!(stream >> names))
+			 continue;
+		std::getline (stream >> std::ws, entry.input);
+		if (entry.input.empty ())
+		{
+			std::cerr << "No input file specified for " << names << " in " << filename << "." << std::endl;
+			return false;
 		}
-		out << ", " << data.size () << ", (const " << typename8 << "[]) {" << std::endl;
+		set_qualified_id (entry, names);
+		entry.stage = stage;
+		entries.push_back (entry);
+	}
+	return true;
+}
+
+void append_dep (std::string &out, const std::string &path)
+{
+	out.append (" \\\n  ");
+	for (size_t i = 0; i < path.size (); i++)
+	{
+		if (path[i] == ' ' || path[i] == '#')
+			 out.push_back ('\\');
+		else if (path[i] == '$')
+			 out.push_back ('$');
+		out.push_back (path[i]);
+	}
+}
+
+bool write_depfile (void)
+{
+	std::string result;
+	result.append (outputfilename);
+	result.push_back (':');
+	if (!manifestfilename.empty ())
+		 append_dep (result, manifestfilename);
+	/* file_cache holds every input and include file that was resolved */
+	for (std::map<std::string, std::vector<char> >::iterator it = file_cache.begin ();
+			 it != file_cache.end (); it++)
+	{
+		append_dep (result, it->first);
+	}
+	result.push_back ('\n');
+
+	std::ofstream out (depfilename.c_str (),
+										 std::ios_base::out|std::ios_base::trunc);
+	out.write (result.data (), result.size ());
+	if (!out)
+	{
+		std::cerr << "Cannot write " << depfilename << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/* Collects every line of at least four characters that occurs in more than
+ * one shader, in order of first occurrence so that runs of common lines
+ * (shared includes, uniform blocks) stay contiguous. */
+std::string build_dictionary (const std::vector<shader_entry> &entries)
+{
+	std::map<std::string, unsigned int> counts;
+	for (size_t i = 0; i < entries.size (); i++)
+	{
+		std::istringstream stream (entries[i].source);
+		std::set<std::string> lines;
+		std::string line;
+		while (std::getline (stream, line))
+		{
+			if (line.size () >= 4 && lines.insert (line).second)
+				 counts[line]++;
+		}
+	}
+
+	std::string result;
+	std::set<std::string> added;
+	for (size_t i = 0; i < entries.size (); i++)
+	{
+		std::istringstream stream (entries[i].source);
+		std::string line;
+		while (std::getline (stream, line))
+		{
+			if (line.size () >= 4 && counts[line] > 1 && added.insert (line).second)
+				 result.append (line + "\n");
+		}
+	}
+	if (result.size () > max_dictionary_size)
+		 result.erase (0, result.size () - max_dictionary_size);
+	return result;
+}
+
+bool compress_shader_with_dictionary (const std::string &data, const std::string &dict,
+																			std::vector<unsigned char> &output)
+{
+	output.resize (LZ4_compressBound (data.size ()));
+	int len;
+	if (hclevel > 0)
+	{
+		LZ4_streamHC_t *stream = LZ4_createStreamHC ();
+		LZ4_resetStreamHC_fast (stream, hclevel);
+		LZ4_loadDictHC (stream, dict.data (), dict.size ());
+		len = LZ4_compress_HC_continue (stream, &data[0], reinterpret_cast<char*> (&output[0]),
+																		data.size (), output.size ());
+		LZ4_freeStreamHC (stream);
+	}
+	else
+	{
+		LZ4_stream_t *stream = LZ4_createStream ();
+		LZ4_loadDict (stream, dict.data (), dict.size ());
+		len = LZ4_compress_fast_continue (stream, &data[0], reinterpret_cast<char*> (&output[0]),
+																			data.size (), output.size (), 1);
+		LZ4_freeStream (stream);
+	}
+	if (len <= 0)
+		 return false;
+	output.resize (len);
+	return true;
+}
+
+/* Recompresses all entries against a shared dictionary; the dictionary is
+ * only used if it reduces the total size including its own compressed data. */
+bool apply_dictionary (std::vector<shader_entry> &entries, shader_entry &dictentry)
+{
+	dictentry.id = dictionaryname;
+	dictentry.source = build_dictionary (entries);
+	dictentry.length = dictentry.source.size ();
+	dictentry.hash = hash_source (dictentry.source);
+	dictentry.codec = CODEC_LZ4;
+	if (dictentry.source.empty () || !compress_shader (dictentry.source, dictentry.output))
+		 return false;
+
+	size_t before = 0, after = dictentry.output.size ();
+	std::vector<std::vector<unsigned char> > outputs (entries.size ());
+	for (size_t i = 0; i < entries.size (); i++)
+	{
+		if (!compress_shader_with_dictionary (entries[i].source, dictentry.source, outputs[i]))
+			 return false;
+		before += entries[i].output.size ();
+		after += outputs[i].size ();
+	}
+
+	std::cout << "dictionary: " << dictentry.length << " bytes, total compressed size "
+						<< before << " -> " << after << " bytes" << std::endl;
+	if (after >= before)
+	{
+		std::cout << "dictionary does not reduce the size, not using it" << std::endl;
+		return false;
+	}
+	for (size_t i = 0; i < entries.size (); i++)
+	{
+		entries[i].output.swap (outputs[i]);
+		entries[i].codec = CODEC_LZ4_DICT;
+	}
+	return true;
+}
+
+void run_benchmark (const std::vector<shader_entry> &entries)
+{
+	static const char *codecs[] = { "raw", "lz4", "lz4hc=4", "lz4hc=9", "lz4hc=12" };
+	const int iterations = 100;
+	std::cout << "codec        size      decode (us)" << std::endl;
+	for (size_t c = 0; c < sizeof (codecs) / sizeof (codecs[0]); c++)
+	{
+		int codec, level;
+		parse_codec (codecs[c], codec, level);
+		std::vector<std::vector<unsigned char> > blobs (entries.size ());
+		size_t size = 0;
+		for (size_t i = 0; i < entries.size (); i++)
+		{
+			compress_shader (entries[i].source, blobs[i], codec, level);
+			size += blobs[i].size ();
+		}
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+		for (int n = 0; n < iterations; n++)
+		{
+			for (size_t i = 0; i < entries.size (); i++)
+			{
+				std::string source (entries[i].length, '\0');
+				if (codec == CODEC_RAW)
+					 memcpy (&source[0], &blobs[i][0], blobs[i].size ());
+				else
+					 LZ4_decompress_safe (reinterpret_cast<const char*> (&blobs[i][0]), &source[0],
+																blobs[i].size (), source.size ());
+			}
+		}
+		double time = std::chrono::duration<double, std::micro>
+			 (std::chrono::steady_clock::now () - start).count () / iterations;
+		char line[64];
+		snprintf (line, sizeof (line), "%-10s %8zu %14.1f", codecs[c], size, time);
+		std::cout << line << std::endl;
+	}
+}
+
+int main (int argc, char *argv[])
+{
+	if (parse_args (argc, argv))
+		 return -1;
+
+	std::vector<shader_entry> entries;
+	if (!manifestfilename.empty ())
+	{
+		if (structname == NULL)
+		{
+			std::cerr << "Batch mode requires -S." << std::endl;
+			return -1;
+		}
+		if (dictionary && codec != CODEC_LZ4)
+		{
+			std::cerr << "A shared dictionary requires lz4 or lz4hc." << std::endl;
+			return -1;
+		}
+		if (!read_manifest (manifestfilename, entries))
+			 return -1;
 	}
 	else
 	{
-		out << "const char *" << id << "_version = ";
-		if (version.empty ()) {
-			out << "nullptr";
-		} else {
-			out << "\"" << version << "\"";
+		if (dictionary)
+		{
+			std::cerr << "A shared dictionary requires batch mode." << std::endl;
+			return -1;
+		}
+		entries.push_back (shader_entry ());
+		set_qualified_id (entries.back (), id);
+		entries.back ().input = inputfilename;
+		entries.back ().stage = stage;
+	}
+
+	{
+		std::atomic<size_t> next (0);
+		std::atomic<bool> failed (false);
+		auto worker = [&] () {
+			for (size_t i = next++; i < entries.size () && !failed; i = next++)
+			{
+				if (!process_shader (entries[i]))
+					 failed = true;
+			}
+		};
+		std::vector<std::thread> threads;
+		size_t count = std::min<size_t> (std::thread::hardware_concurrency (), entries.size ());
+		for (size_t i = 1; i < count; i++)
+		{
+			threads.emplace_back (worker);
 		}
-		out << ";" << std::endl
-			    << typename32 << " " << id << "_length = "
-				<< std::dec << data.size () << ";" << std::endl
-				<< "const " << typename8 << " " << id << "_data[] = {" << std::endl;
+		worker ();
+		for (auto &thread : threads)
+		{
+			thread.join ();
+		}
+		if (failed)
+			 return -1;
 	}
-	int i = 0;
-	while (len - i > 8)
+
+	if (minify)
 	{
-		out << "    ";
-		for (int c = 0; c < 7; c++)
+		for (size_t i = 0; i < entries.size (); i++)
 		{
-			out << "0x" << std::hex << std::setfill ('0')
-					<< std::setw (2) << (unsigned int) (output[i++])
-					<< std::dec << ", ";
+			const shader_entry &entry = entries[i];
+			std::cout << entry.id << ": source " << entry.originallength << " -> "
+								<< entry.length << " bytes, compressed " << entry.originalsize
+								<< " -> " << entry.output.size () << " bytes" << std::endl;
 		}
-		out << "0x" << std::hex << std::setfill ('0')
-				<< std::setw (2) << (unsigned int) (output[i++])
-				<< std::dec << "," << std::endl;
 	}
-	out << "    ";
-	for (; i < len - 1; i++)
+
+	if (benchmark)
+		 run_benchmark (entries);
+
+	shader_entry dictentry;
+	if (headeronly)
 	{
-		out << "0x" << std::hex << std::setfill ('0')
-				<< std::setw (2) << (unsigned int) (output[i])
-				<< std::dec << ", ";
+		/* several generated headers may end up in one translation unit */
+		dictionaryname += "_" + make_identifier (outputfilename.substr (outputfilename.find_last_of ("/\\") + 1));
 	}
-	out << "0x" << std::hex << std::setfill ('0')
-			<< std::setw (2) << (unsigned int) (output[i]) << std::endl;
-	if (structname != NULL)
+	bool usedictionary = dictionary && apply_dictionary (entries, dictentry);
+
+	std::string result;
+	result.append ("/* this file was generated by glsl2cpp\n"
+				   " * do not attempt to edit it directly */\n");
+
+	std::string guard;
+	if (headeronly)
+	{
+		guard = "GLSL2CPP_" + make_identifier (outputfilename.substr (outputfilename.find_last_of ("/\\") + 1));
+		std::transform (guard.begin (), guard.end (), guard.begin (), ::toupper);
+		result.append ("#ifndef " + guard + "\n#define " + guard + "\n\n");
+	}
+
+	for (std::vector<std::string>::iterator it = headers.begin ();
+			 it != headers.end (); it++)
+	{
+		result.append ("#include " + *it + "\n");
+	}
+	result.push_back ('\n');
+
+	/* the dictionary is referenced from the global namespace, so it has to
+	 * precede any namespaces opened by -P */
+	if (usedictionary)
 	{
-		out << "}";
+		emit_shader (result, dictentry);
+		result.push_back ('\n');
+	}
+
+	for (std::vector<std::string>::iterator it = prepend.begin ();
+			 it != prepend.end (); it++)
+	{
+		result.append (*it + "\n");
+	}
+	if (!prepend.empty ())
+		 result.push_back ('\n');
+
+	for (size_t i = 0; i < entries.size (); i++)
+	{
+		if (i > 0)
+			 result.push_back ('\n');
+		emit_shader (result, entries[i]);
 	}
-	out << "};" << std::endl;
 
 	if (!append.empty ())
-		 out << std::endl;
+		 result.push_back ('\n');
 
 	for (std::vector<std::string>::iterator it = append.begin ();
 			 it != append.end (); it++)
 	{
-		out << (*it) << std::endl;
+		result.append (*it + "\n");
+	}
+
+	if (headeronly)
+	{
+		result.append ("\n#endif /* !defined " + guard + " */\n");
 	}
 
+	/* opened only now, so that a failed shader leaves the previous output untouched */
+	std::ofstream out (outputfilename.c_str (),
+										 std::ios_base::out|std::ios_base::trunc);
+	if (!out.is_open ())
+	{
+		std::cerr << "Cannot open " << outputfilename << std::endl;
+		return -1;
+	}
+	out.write (result.data (), result.size ());
+	out.close ();
+	if (!out)
+	{
+		std::cerr << "Cannot write " << outputfilename << std::endl;
+		remove (outputfilename.c_str ());
+		return -1;
+	}
+
+	if (!depfilename.empty () && !write_depfile ())
+		 return -1;
+
 	return 0;
 }